@@ -1,6 +1,6 @@
-/* cat.c
+/* cp.c
 
-Copies one file to another. */
+   Copies one file to another. */
 
 #include <stdio.h>
 #include <syscall.h>
@@ -9,6 +9,7 @@ int
 main (int argc, char *argv[]) 
 {
   int in_fd, out_fd;
+  int size, offset, bytes_copied;
 
   if (argc != 3) 
     {
@@ -24,8 +25,10 @@ main (int argc, char *argv[])
       return EXIT_FAILURE;
     }
 
+  size = filesize (in_fd);
+
   /* Create and open output file. */
-  if (!create (argv[2], filesize (in_fd))) 
+  if (!create (argv[2], size)) 
     {
       printf ("%s: create failed\n", argv[2]);
       return EXIT_FAILURE;
@@ -37,16 +40,13 @@ main (int argc, char *argv[])
       return EXIT_FAILURE;
     }
 
-  /* Copy data. */
-  for (;;) 
+  /* Copy data, letting the kernel move it from file to file. */
+  for (offset = 0; offset < size; offset += bytes_copied) 
     {
-      char buffer[1024];
-      int bytes_read = read (in_fd, buffer, sizeof buffer);
-      if (bytes_read == 0)
-        break;
-      if (write (out_fd, buffer, bytes_read) != bytes_read) 
+      bytes_copied = copy_file (in_fd, out_fd, offset, size - offset);
+      if (bytes_copied <= 0) 
         {
-          printf ("%s: write failed\n", argv[2]);
+          printf ("%s: copy failed\n", argv[2]);
           return EXIT_FAILURE;
         }
     }
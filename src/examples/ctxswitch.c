@@ -0,0 +1,109 @@
+/* ctxswitch.c
+
+   Measures the TLB refill cost that a switch between two user
+   processes imposes on the kernel.
+
+   It forks two children that compete for the CPU, so that the
+   timer keeps switching between their address spaces.  Each
+   child times a trivial system call over and over with the CPU's
+   time-stamp counter.  A call that follows a long gap ran right
+   after a switch back from the other process, with whatever the
+   CR3 reload flushed from the TLB; the rest ran with a warm TLB.
+   The difference between the two averages is the refill cost of
+   a switch.
+
+   Compare a normal boot against one with the kernel's -nopse
+   option to see the effect of global 4 MB kernel pages. */
+
+#include <stdio.h>
+#include <syscall.h>
+
+/* Number of timed system calls made by each child. */
+#define CALLS 100000
+
+/* A gap of more than this many cycles between two calls means
+   that the other process ran in between. */
+#define SWITCH_GAP 1000000
+
+/* Returns the CPU's time-stamp counter. */
+static inline unsigned long long
+rdtsc (void)
+{
+  unsigned long long tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
+/* Times CALLS system calls and reports the average cost of the
+   calls made with a warm TLB and of those made right after a
+   switch. */
+static void
+child (const char *name)
+{
+  unsigned long long warm_cycles = 0, cold_cycles = 0;
+  unsigned warm_cnt = 0, cold_cnt = 0;
+  unsigned long long prev_end;
+  int i;
+
+  prev_end = rdtsc ();
+  for (i = 0; i < CALLS; i++)
+    {
+      unsigned long long start, end;
+
+      start = rdtsc ();
+      write (STDOUT_FILENO, "", 0);
+      end = rdtsc ();
+
+      /* Discard calls that were themselves interrupted by a
+         switch. */
+      if (end - start <= SWITCH_GAP)
+        {
+          if (start - prev_end > SWITCH_GAP)
+            {
+              cold_cycles += end - start;
+              cold_cnt++;
+            }
+          else
+            {
+              warm_cycles += end - start;
+              warm_cnt++;
+            }
+        }
+      prev_end = end;
+    }
+
+  printf ("%s: %u warm calls, %llu cycles each\n",
+          name, warm_cnt, warm_cnt ? warm_cycles / warm_cnt : 0);
+  printf ("%s: %u calls after a switch, %llu cycles each\n",
+          name, cold_cnt, cold_cnt ? cold_cycles / cold_cnt : 0);
+}
+
+/* Forks a child that runs child() as NAME, and returns its
+   process id. */
+static pid_t
+start (const char *name)
+{
+  pid_t pid = fork ();
+  if (pid == 0)
+    {
+      child (name);
+      exit (EXIT_SUCCESS);
+    }
+  if (pid == PID_ERROR)
+    {
+      printf ("ctxswitch: fork failed\n");
+      exit (EXIT_FAILURE);
+    }
+  return pid;
+}
+
+int
+main (void)
+{
+  pid_t a = start ("a");
+  pid_t b = start ("b");
+
+  wait (a);
+  wait (b);
+  return EXIT_SUCCESS;
+}
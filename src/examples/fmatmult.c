@@ -0,0 +1,43 @@
+/* fmatmult.c
+
+   Floating-point version of matmult.c: multiplies two matrices
+   of doubles with the FPU.
+
+   Run several copies at once to exercise the kernel's switching
+   of FPU state between processes. */
+
+#include <stdio.h>
+#include <syscall.h>
+
+/* Matrix dimension.  See matmult.c for memory requirements,
+   doubled here because a double is twice the size of an int. */
+#define DIM 128
+
+double A[DIM][DIM];
+double B[DIM][DIM];
+double C[DIM][DIM];
+
+int
+main (void)
+{
+  int i, j, k;
+
+  /* Initialize the matrices. */
+  for (i = 0; i < DIM; i++)
+    for (j = 0; j < DIM; j++)
+      {
+	A[i][j] = i * 0.5;
+	B[i][j] = j * 0.25;
+	C[i][j] = 0.0;
+      }
+
+  /* Multiply matrices. */
+  for (i = 0; i < DIM; i++)
+    for (j = 0; j < DIM; j++)
+      for (k = 0; k < DIM; k++)
+	C[i][j] += A[i][k] * B[k][j];
+
+  /* Done.  All of the products and sums are exact, so this is
+     DIM * (DIM - 1) / 2 * (DIM - 1) / 4. */
+  exit ((int) C[DIM - 1][DIM - 1]);
+}
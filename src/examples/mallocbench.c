@@ -0,0 +1,130 @@
+/* mallocbench.c
+
+   Measures the throughput of the user memory allocator.  Times
+   malloc() and free() pairs of one size, which the size classes
+   serve from a free list; a batch of blocks of random sizes
+   allocated and then freed in random order; and a block grown
+   by realloc() a little at a time.  Each test is timed with the
+   CPU's time-stamp counter and reported in cycles per
+   operation. */
+
+#include <random.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <syscall.h>
+
+#define PAIRS 10000                     /* Pairs per size. */
+#define BATCH 2000                      /* Blocks in a batch. */
+#define GROW_STEP 64                    /* realloc() increment. */
+#define GROW_SIZE (256 * 1024)          /* realloc() final size. */
+
+static void *blocks[BATCH];
+
+/* Returns the CPU's time-stamp counter. */
+static inline unsigned long long
+rdtsc (void)
+{
+  unsigned long long tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
+/* Fails with MESSAGE. */
+static void
+fail (const char *message)
+{
+  printf ("mallocbench: %s\n", message);
+  exit (1);
+}
+
+/* Times PAIRS calls to malloc(SIZE), each followed by free(). */
+static void
+bench_pairs (size_t size)
+{
+  unsigned long long start;
+  int i;
+
+  start = rdtsc ();
+  for (i = 0; i < PAIRS; i++)
+    {
+      void *p = malloc (size);
+      if (p == NULL)
+        fail ("malloc failed");
+      free (p);
+    }
+  printf ("malloc+free %6zu bytes:  %6llu cycles per pair\n",
+          size, (rdtsc () - start) / PAIRS);
+}
+
+/* Times allocating BATCH blocks of random sizes up to MAX_SIZE
+   bytes and then freeing them in random order. */
+static void
+bench_batch (size_t max_size)
+{
+  unsigned long long start, alloc_cycles;
+  int i;
+
+  start = rdtsc ();
+  for (i = 0; i < BATCH; i++)
+    {
+      blocks[i] = malloc (random_ulong () % max_size + 1);
+      if (blocks[i] == NULL)
+        fail ("malloc failed");
+    }
+  alloc_cycles = rdtsc () - start;
+
+  /* Shuffle. */
+  for (i = BATCH - 1; i > 0; i--)
+    {
+      int j = random_ulong () % (i + 1);
+      void *t = blocks[i];
+      blocks[i] = blocks[j];
+      blocks[j] = t;
+    }
+
+  start = rdtsc ();
+  for (i = 0; i < BATCH; i++)
+    free (blocks[i]);
+  printf ("batch of %d up to %6zu bytes: %6llu cycles per malloc, "
+          "%6llu per free\n", BATCH, max_size, alloc_cycles / BATCH,
+          (rdtsc () - start) / BATCH);
+}
+
+/* Times growing a block to GROW_SIZE bytes, GROW_STEP bytes at a
+   time. */
+static void
+bench_realloc (void)
+{
+  unsigned long long start;
+  char *p = NULL;
+  size_t size;
+
+  start = rdtsc ();
+  for (size = GROW_STEP; size <= GROW_SIZE; size += GROW_STEP)
+    {
+      p = realloc (p, size);
+      if (p == NULL)
+        fail ("realloc failed");
+      p[size - 1] = 0;
+    }
+  free (p);
+  printf ("realloc by %d bytes to %d kB: %6llu cycles per call\n",
+          GROW_STEP, GROW_SIZE / 1024,
+          (rdtsc () - start) / (GROW_SIZE / GROW_STEP));
+}
+
+int
+main (void)
+{
+  static const size_t sizes[] = {16, 64, 256, 1024, 4096, 65536};
+  size_t i;
+
+  random_init (0);
+  for (i = 0; i < sizeof sizes / sizeof *sizes; i++)
+    bench_pairs (sizes[i]);
+  bench_batch (256);
+  bench_batch (4096);
+  bench_realloc ();
+  printf ("heap ends at %p\n", sbrk (0));
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,117 @@
+/* nullsyscall.c
+
+   Measures the round-trip cost of a system call that does no
+   work, entering the kernel with int $0x30 and, if the CPU
+   supports it, with SYSENTER.
+
+   The call is tell() on a handle that is not open, which the
+   kernel answers without touching anything but the process's
+   file table.  Each way in is timed separately with the CPU's
+   time-stamp counter over a batch of calls, keeping the best of
+   several batches so that timer interrupts do not skew the
+   result.
+
+   For comparison, it also times clock_ticks(), which reads the
+   kernel data page without entering the kernel at all. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include <syscall-nr.h>
+
+/* Number of calls in one timed batch. */
+#define CALLS 10000
+
+/* Number of batches to take the best of. */
+#define BATCHES 10
+
+/* A handle that is never open. */
+#define BAD_HANDLE -1
+
+/* Returns the CPU's time-stamp counter. */
+static inline unsigned long long
+rdtsc (void)
+{
+  unsigned long long tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
+/* Returns true if CPUID reports SYSENTER and SYSEXIT. */
+static bool
+have_sysenter (void)
+{
+  unsigned eax = 1, ebx, ecx, edx;
+  asm ("cpuid" : "+a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx));
+  return (edx & 0x00000800) != 0;
+}
+
+/* Makes the null system call with int $0x30. */
+static inline void
+call_int (void)
+{
+  int retval;
+  asm volatile ("pushl %[arg0]; pushl %[number]; int $0x30; addl $8, %%esp"
+                : "=a" (retval)
+                : [number] "i" (SYS_TELL), [arg0] "i" (BAD_HANDLE)
+                : "memory");
+}
+
+/* Makes the null system call with SYSENTER. */
+static inline void
+call_sysenter (void)
+{
+  int retval;
+  asm volatile ("pushl %[arg0]; pushl %[number]; "
+                "movl %%esp, %%ecx; movl $1f, %%edx; "
+                "sysenter; 1: addl $8, %%esp"
+                : "=a" (retval)
+                : [number] "i" (SYS_TELL), [arg0] "i" (BAD_HANDLE)
+                : "ecx", "edx", "memory");
+}
+
+/* Reads the time from the kernel data page. */
+static void
+call_clock (void)
+{
+  clock_ticks ();
+}
+
+/* Returns the fewest cycles per call that BATCHES batches of
+   CALLS calls to CALL took. */
+static unsigned long long
+measure (void (*call) (void))
+{
+  unsigned long long best = 0;
+  int batch;
+
+  for (batch = 0; batch < BATCHES; batch++)
+    {
+      unsigned long long start, cycles;
+      int i;
+
+      start = rdtsc ();
+      for (i = 0; i < CALLS; i++)
+        call ();
+      cycles = (rdtsc () - start) / CALLS;
+      if (batch == 0 || cycles < best)
+        best = cycles;
+    }
+  return best;
+}
+
+int
+main (void)
+{
+  unsigned long long int_cycles = measure (call_int);
+
+  printf ("int $0x30: %llu cycles per call\n", int_cycles);
+  if (have_sysenter ())
+    {
+      unsigned long long sysenter_cycles = measure (call_sysenter);
+      printf ("sysenter:  %llu cycles per call\n", sysenter_cycles);
+    }
+  else
+    printf ("sysenter:  not supported by this CPU\n");
+  printf ("clock_ticks(): %llu cycles per call\n", measure (call_clock));
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,112 @@
+/* ringbench.c
+
+   Compares many small reads made one system call at a time,
+   with pread(), against the same reads submitted in batches
+   through submission and completion rings, counting system
+   calls and timing each run with the CPU's time-stamp counter. */
+
+#include <random.h>
+#include <ring.h>
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+
+#define FILE_SIZE (64 * 1024)           /* Size of the file read. */
+#define READ_CNT 1024                   /* Reads per run. */
+#define READ_SIZE 64                    /* Bytes per read. */
+#define BATCH 32                        /* Reads per ring_enter(). */
+
+static const char file_name[] = "ringbench.dat";
+
+static struct ring_area *ring = (struct ring_area *) 0x10000000;
+
+/* Offsets to read from. */
+static int offsets[READ_CNT];
+
+static char buffer[READ_SIZE];
+
+/* Returns the CPU's time-stamp counter. */
+static inline unsigned long long
+rdtsc (void)
+{
+  unsigned long long tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
+/* Fails with MESSAGE. */
+static void
+fail (const char *message)
+{
+  printf ("ringbench: %s\n", message);
+  exit (1);
+}
+
+/* Prints a line of results for a run named NAME that made CALLS
+   system calls, starting at time-stamp START. */
+static void
+report (const char *name, int calls, unsigned long long start)
+{
+  unsigned long long cycles = rdtsc () - start;
+
+  printf ("%-6s %5d calls, %10llu cycles, %6llu cycles per read\n",
+          name, calls, cycles, cycles / READ_CNT);
+}
+
+int
+main (void)
+{
+  unsigned long long start;
+  int handle, calls, i, j;
+
+  remove (file_name);
+  if (!create (file_name, FILE_SIZE))
+    fail ("create failed");
+  handle = open (file_name);
+  if (handle < 0)
+    fail ("open failed");
+  for (i = 0; i < FILE_SIZE; i += sizeof buffer)
+    {
+      memset (buffer, i / sizeof buffer, sizeof buffer);
+      write (handle, buffer, sizeof buffer);
+    }
+
+  random_init (0);
+  for (i = 0; i < READ_CNT; i++)
+    offsets[i] = random_ulong () % (FILE_SIZE / READ_SIZE) * READ_SIZE;
+
+  if (!ring_setup (ring))
+    fail ("ring_setup failed");
+
+  /* One system call per read. */
+  start = rdtsc ();
+  for (calls = i = 0; i < READ_CNT; i++, calls++)
+    if (pread (handle, buffer, READ_SIZE, offsets[i]) != READ_SIZE)
+      fail ("pread failed");
+  report ("pread", calls, start);
+
+  /* BATCH reads per system call. */
+  start = rdtsc ();
+  for (calls = i = 0; i < READ_CNT; i += BATCH, calls++)
+    {
+      struct ring_cqe cqe;
+
+      for (j = 0; j < BATCH; j++)
+        {
+          struct ring_sqe sqe = {RING_READ, handle, offsets[i + j],
+                                 j * READ_SIZE, READ_SIZE, i + j};
+          if (!ring_push (ring, &sqe))
+            fail ("submission queue full");
+        }
+      if (ring_enter (BATCH) < BATCH)
+        fail ("ring_enter came up short");
+      while (ring_pop (ring, &cqe))
+        if (cqe.result != READ_SIZE)
+          fail ("ring read failed");
+    }
+  report ("ring", calls, start);
+
+  close (handle);
+  remove (file_name);
+  return 0;
+}
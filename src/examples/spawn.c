@@ -0,0 +1,118 @@
+/* spawn.c
+
+   Measures the cost of creating and reaping child processes, by
+   starting thousands of them, like a much wider multi-recurse.
+
+   Usage: spawn [COUNT]
+
+   Starts COUNT children (by default, 1000) three ways, timing
+   each with the CPU's time-stamp counter:
+
+     - one at a time with exec(), waiting for each before
+       starting the next;
+
+     - BATCH at a time with exec(), waiting for each batch in
+       reverse order, so that many children are alive, and many
+       exited ones unreaped, at once;
+
+     - one at a time with fork().
+
+   Each child exits at once with status 0, which the parent
+   checks.  "spawn 0" is the child. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <syscall.h>
+
+/* Number of children alive at once in the batched run. */
+#define BATCH 16
+
+/* Returns the CPU's time-stamp counter. */
+static inline unsigned long long
+rdtsc (void)
+{
+  unsigned long long tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
+/* Waits for PID and checks that it exited with status 0. */
+static void
+reap (pid_t pid)
+{
+  int status = wait (pid);
+  if (status != 0)
+    {
+      printf ("spawn: child %d exited with status %d\n", pid, status);
+      exit (EXIT_FAILURE);
+    }
+}
+
+/* Starts a child with exec() and returns its pid. */
+static pid_t
+spawn (void)
+{
+  pid_t pid = exec ("spawn 0");
+  if (pid == PID_ERROR)
+    {
+      printf ("spawn: exec failed\n");
+      exit (EXIT_FAILURE);
+    }
+  return pid;
+}
+
+/* Prints the time taken to start and reap COUNT children from
+   START until now. */
+static void
+report (const char *how, int count, unsigned long long start)
+{
+  printf ("%s: %d children, %llu cycles each\n",
+          how, count, (rdtsc () - start) / count);
+}
+
+int
+main (int argc, char *argv[])
+{
+  int count = argc > 1 ? atoi (argv[1]) : 1000;
+  unsigned long long start;
+  int i;
+
+  if (count <= 0)
+    return 0;
+
+  start = rdtsc ();
+  for (i = 0; i < count; i++)
+    reap (spawn ());
+  report ("exec, one at a time", count, start);
+
+  start = rdtsc ();
+  for (i = 0; i < count; i += BATCH)
+    {
+      pid_t pids[BATCH];
+      int n = count - i < BATCH ? count - i : BATCH;
+      int j;
+
+      for (j = 0; j < n; j++)
+        pids[j] = spawn ();
+      for (j = n - 1; j >= 0; j--)
+        reap (pids[j]);
+    }
+  report ("exec, in batches", count, start);
+
+  start = rdtsc ();
+  for (i = 0; i < count; i++)
+    {
+      pid_t pid = fork ();
+      if (pid == 0)
+        exit (0);
+      else if (pid == PID_ERROR)
+        {
+          printf ("spawn: fork failed\n");
+          return EXIT_FAILURE;
+        }
+      reap (pid);
+    }
+  report ("fork, one at a time", count, start);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,79 @@
+/* stdiobench.c
+
+   Compares writing formatted text to a file with hprintf(), which
+   makes a write() system call for every call, against fprintf()
+   on a fully buffered stream, which makes one per BUFSIZ bytes.
+   Reports the number of write() calls each way and times each
+   run with the CPU's time-stamp counter. */
+
+#include <stdio.h>
+#include <syscall.h>
+
+#define LINES 500                       /* Lines written per run. */
+#define LINE_SIZE 30                    /* Bytes per line. */
+#define FILE_SIZE (LINES * LINE_SIZE)
+
+static const char file_name[] = "stdiobench.out";
+
+/* Returns the CPU's time-stamp counter. */
+static inline unsigned long long
+rdtsc (void)
+{
+  unsigned long long tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
+/* Fails with MESSAGE. */
+static void
+fail (const char *message)
+{
+  printf ("stdiobench: %s\n", message);
+  exit (1);
+}
+
+/* Prints a line of results for a run named NAME that made CALLS
+   write() calls, starting at time-stamp START. */
+static void
+report (const char *name, int calls, unsigned long long start)
+{
+  unsigned long long cycles = rdtsc () - start;
+
+  printf ("%-8s %5d writes, %10llu cycles, %6llu cycles per line\n",
+          name, calls, cycles, cycles / LINES);
+}
+
+int
+main (void)
+{
+  unsigned long long start;
+  FILE *stream;
+  int handle, i;
+
+  remove (file_name);
+  if (!create (file_name, FILE_SIZE))
+    fail ("create failed");
+  handle = open (file_name);
+  if (handle < 0)
+    fail ("open failed");
+
+  /* Each line is exactly LINE_SIZE bytes. */
+  start = rdtsc ();
+  for (i = 0; i < LINES; i++)
+    hprintf (handle, "%5d: the quick brown fox...\n", i);
+  report ("hprintf", LINES, start);
+
+  seek (handle, 0);
+  stream = fdopen (handle, "w");
+  if (stream == NULL)
+    fail ("fdopen failed");
+  start = rdtsc ();
+  for (i = 0; i < LINES; i++)
+    fprintf (stream, "%5d: the quick brown fox...\n", i);
+  if (fclose (stream) != 0)
+    fail ("fclose failed");
+  report ("fprintf", (FILE_SIZE + BUFSIZ - 1) / BUFSIZ, start);
+
+  remove (file_name);
+  return 0;
+}
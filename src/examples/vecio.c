@@ -0,0 +1,159 @@
+/* vecio.c
+
+   Compares vectored and positional I/O with plain read() and
+   write(), counting system calls and timing each run with the
+   CPU's time-stamp counter.
+
+   Writes a file of RECORDS records, each gathered from FIELDS
+   separate buffers, once with a write() per buffer and once with
+   a writev() per record.  Then reads every record back in a
+   scrambled order, once with a seek() and a read() per record
+   and once with a pread() per record. */
+
+#include <random.h>
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+
+#define RECORDS 64                      /* Records in the file. */
+#define FIELDS 8                        /* Buffers per record. */
+#define FIELD_SIZE 64                   /* Bytes per buffer. */
+#define RECORD_SIZE (FIELDS * FIELD_SIZE)
+#define FILE_SIZE (RECORDS * RECORD_SIZE)
+
+static const char file_name[] = "vecio.dat";
+
+/* The fields of one record, and a record read back. */
+static char fields[FIELDS][FIELD_SIZE];
+static char record[RECORD_SIZE];
+
+/* Order in which to read records back. */
+static int order[RECORDS];
+
+/* Returns the CPU's time-stamp counter. */
+static inline unsigned long long
+rdtsc (void)
+{
+  unsigned long long tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
+/* Prints a line of results for a run named NAME that made
+   CALLS system calls to transfer FILE_SIZE bytes, starting at
+   time-stamp START. */
+static void
+report (const char *name, int calls, unsigned long long start)
+{
+  unsigned long long cycles = rdtsc () - start;
+
+  printf ("%-12s %5d calls, %9llu cycles, %5llu bytes per kcycle\n",
+          name, calls, cycles, FILE_SIZE * 1000ULL / (cycles + 1));
+}
+
+/* Fails with MESSAGE. */
+static void
+fail (const char *message)
+{
+  printf ("vecio: %s\n", message);
+  exit (1);
+}
+
+/* Checks that RECORD holds record number R. */
+static void
+check_record (int r)
+{
+  int i;
+
+  for (i = 0; i < RECORD_SIZE; i++)
+    if (record[i] != (char) (r + i / FIELD_SIZE))
+      fail ("read back wrong data");
+}
+
+/* Fills FIELDS with record number R. */
+static void
+fill_fields (int r)
+{
+  int i;
+
+  for (i = 0; i < FIELDS; i++)
+    memset (fields[i], r + i, FIELD_SIZE);
+}
+
+int
+main (void)
+{
+  struct iovec iov[FIELDS];
+  unsigned long long start;
+  int handle, calls, r, i;
+
+  remove (file_name);
+  if (!create (file_name, FILE_SIZE))
+    fail ("create failed");
+  handle = open (file_name);
+  if (handle < 0)
+    fail ("open failed");
+
+  for (i = 0; i < FIELDS; i++)
+    {
+      iov[i].iov_base = fields[i];
+      iov[i].iov_len = FIELD_SIZE;
+    }
+  for (r = 0; r < RECORDS; r++)
+    order[r] = r;
+  random_init (0);
+  for (r = RECORDS - 1; r > 0; r--)
+    {
+      int j = random_ulong () % (r + 1);
+      int t = order[r];
+      order[r] = order[j];
+      order[j] = t;
+    }
+
+  /* Gathered writes. */
+  seek (handle, 0);
+  start = rdtsc ();
+  for (calls = r = 0; r < RECORDS; r++)
+    {
+      fill_fields (r);
+      for (i = 0; i < FIELDS; i++, calls++)
+        if (write (handle, fields[i], FIELD_SIZE) != FIELD_SIZE)
+          fail ("write failed");
+    }
+  report ("write", calls, start);
+
+  seek (handle, 0);
+  start = rdtsc ();
+  for (calls = r = 0; r < RECORDS; r++, calls++)
+    {
+      fill_fields (r);
+      if (writev (handle, iov, FIELDS) != RECORD_SIZE)
+        fail ("writev failed");
+    }
+  report ("writev", calls, start);
+
+  /* Random-access reads. */
+  start = rdtsc ();
+  for (calls = r = 0; r < RECORDS; r++, calls += 2)
+    {
+      seek (handle, order[r] * RECORD_SIZE);
+      if (read (handle, record, RECORD_SIZE) != RECORD_SIZE)
+        fail ("read failed");
+      check_record (order[r]);
+    }
+  report ("seek+read", calls, start);
+
+  start = rdtsc ();
+  for (calls = r = 0; r < RECORDS; r++, calls++)
+    {
+      if (pread (handle, record, RECORD_SIZE, order[r] * RECORD_SIZE)
+          != RECORD_SIZE)
+        fail ("pread failed");
+      check_record (order[r]);
+    }
+  report ("pread", calls, start);
+
+  close (handle);
+  remove (file_name);
+  return 0;
+}
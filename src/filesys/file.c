@@ -2,6 +2,8 @@
 #include <debug.h>
 #include "filesys/inode.h"
 #include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
 
 /* An open file. */
 struct file 
@@ -9,6 +11,7 @@ struct file
     struct inode *inode;        /* File's inode. */
     off_t pos;                  /* Current position. */
     bool deny_write;            /* Has file_deny_write() been called? */
+    int ref_cnt;                /* Number of references. */
   };
 
 /* Opens a file for the given INODE, of which it takes ownership,
@@ -23,6 +26,7 @@ file_open (struct inode *inode)
       file->inode = inode;
       file->pos = 0;
       file->deny_write = false;
+      file->ref_cnt = 1;
       return file;
     }
   else
@@ -41,11 +45,21 @@ file_reopen (struct file *file)
   return file_open (inode_reopen (file->inode));
 }
 
-/* Closes FILE. */
+/* Returns FILE with an additional reference, which shares its
+   file position and must be released with file_close(). */
+struct file *
+file_dup (struct file *file) 
+{
+  file->ref_cnt++;
+  return file;
+}
+
+/* Releases a reference to FILE, closing it once no reference
+   remains. */
 void
 file_close (struct file *file) 
 {
-  if (file != NULL)
+  if (file != NULL && --file->ref_cnt == 0)
     {
       file_allow_write (file);
       inode_close (file->inode);
@@ -113,6 +127,49 @@ file_write_at (struct file *file, const void *buffer, off_t size,
   return inode_write_at (file->inode, buffer, size, file_ofs);
 }
 
+/* Copies SIZE bytes from IN, starting at offset IN_OFS, to OUT,
+   starting at offset OUT_OFS, without passing them through user
+   memory.  Returns the number of bytes actually copied, which
+   may be less than SIZE if end of either file is reached or if
+   no memory is available.  Neither file's position is affected.
+   If IN and OUT are the same file, the two ranges should not
+   overlap.
+
+   The data moves a page at a time through a kernel buffer.
+   Every chunk but the first starts on a sector boundary of IN,
+   so when IN_OFS and OUT_OFS are equally aligned within a
+   sector, as they are when copying a whole file, whole sectors
+   go straight between the buffer and the disk without a bounce
+   buffer. */
+off_t
+file_copy_at (struct file *in, off_t in_ofs,
+              struct file *out, off_t out_ofs, off_t size) 
+{
+  uint8_t *buffer = palloc_get_page (0);
+  off_t bytes_copied = 0;
+
+  if (buffer == NULL)
+    return 0;
+  while (size > 0) 
+    {
+      off_t chunk = PGSIZE - in_ofs % BLOCK_SECTOR_SIZE;
+      off_t n;
+
+      if (chunk > size)
+        chunk = size;
+      n = inode_read_at (in->inode, buffer, chunk, in_ofs);
+      n = inode_write_at (out->inode, buffer, n, out_ofs);
+      bytes_copied += n;
+      in_ofs += n;
+      out_ofs += n;
+      size -= n;
+      if (n < chunk)
+        break;
+    }
+  palloc_free_page (buffer);
+  return bytes_copied;
+}
+
 /* Prevents write operations on FILE's underlying inode
    until file_allow_write() is called or FILE is closed. */
 void
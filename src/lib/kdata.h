@@ -0,0 +1,29 @@
+#ifndef __LIB_KDATA_H
+#define __LIB_KDATA_H
+
+#include <stdint.h>
+
+/* A page of data that the kernel maps read-only into every user
+   process at KDATA_ADDR, so that the process can read it without
+   entering the kernel.
+
+   The kernel keeps TICKS current for the running process, in the
+   timer interrupt and whenever the process is switched in.  A
+   64-bit value cannot be read atomically, so the kernel makes SEQ
+   odd while it writes TICKS and even again afterward.  A reader
+   reads SEQ, then TICKS, then SEQ again, and retries if SEQ was
+   odd or changed, which means that it was interrupted by an
+   update. */
+struct kdata
+  {
+    volatile unsigned seq;      /* Sequence count for TICKS. */
+    volatile int64_t ticks;     /* Timer ticks since the OS booted. */
+    int timer_freq;             /* Timer ticks per second. */
+    int pid;                    /* The process's pid. */
+  };
+
+/* User virtual address of the page, just below the 8 MB that
+   the top of user memory keeps for the stack. */
+#define KDATA_ADDR ((struct kdata *) 0xbf7ff000)
+
+#endif /* lib/kdata.h */
@@ -0,0 +1,184 @@
+#include "lz.h"
+#include <debug.h>
+#include <stdbool.h>
+#include <string.h>
+
+/* Longest block that offsets and the hash table can handle. */
+#define LZ_MAX_SIZE 65535
+
+/* Returns the 4 bytes at P as a 32-bit integer. */
+static inline uint32_t
+read32 (const uint8_t *p)
+{
+  uint32_t x;
+  memcpy (&x, p, sizeof x);
+  return x;
+}
+
+/* Returns the hash table index for the 4 bytes X. */
+static inline unsigned
+hash4 (uint32_t x)
+{
+  return (x * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+/* Appends LENGTH - 15, the extension of a length nibble of 15, at
+   *OP, if there is room before OEND.  Returns false if not. */
+static bool
+put_length (uint8_t **op, uint8_t *oend, size_t length)
+{
+  for (length -= 15; ; length -= 255)
+    {
+      if (*op >= oend)
+        return false;
+      *(*op)++ = length < 255 ? length : 255;
+      if (length < 255)
+        return true;
+    }
+}
+
+/* Appends a sequence to *OP, which must not pass OEND: the
+   LIT_CNT literals at LIT, then a match of MATCH_LEN bytes at
+   OFFSET bytes back, or no match if MATCH_LEN is 0.  Returns
+   false if there is not enough room. */
+static bool
+put_sequence (uint8_t **op, uint8_t *oend, const uint8_t *lit,
+              size_t lit_cnt, size_t offset, size_t match_len)
+{
+  uint8_t *token;
+  size_t ml = match_len - LZ_MIN_MATCH;
+
+  if (*op >= oend)
+    return false;
+  token = (*op)++;
+  *token = (lit_cnt < 15 ? lit_cnt : 15) << 4;
+  if (lit_cnt >= 15 && !put_length (op, oend, lit_cnt))
+    return false;
+  if ((size_t) (oend - *op) < lit_cnt)
+    return false;
+  memcpy (*op, lit, lit_cnt);
+  *op += lit_cnt;
+
+  if (match_len == 0)
+    return true;
+  if (oend - *op < 2)
+    return false;
+  *(*op)++ = offset & 0xff;
+  *(*op)++ = offset >> 8;
+  *token |= ml < 15 ? ml : 15;
+  return ml < 15 || put_length (op, oend, ml);
+}
+
+/* Compresses the SRC_SIZE bytes at SRC into DST, which has room
+   for DST_SIZE bytes, using WORK as scratch space.  Returns the
+   compressed size, or 0 if it would exceed DST_SIZE. */
+size_t
+lz_compress (const void *src_, size_t src_size,
+             void *dst_, size_t dst_size, struct lz_work *work)
+{
+  const uint8_t *src = src_;
+  const uint8_t *end = src + src_size;
+  const uint8_t *ip = src;
+  const uint8_t *anchor = src;
+  uint8_t *dst = dst_;
+  uint8_t *op = dst;
+  uint8_t *oend = dst + dst_size;
+
+  ASSERT (src_size <= LZ_MAX_SIZE);
+
+  /* Stale entries are harmless, because every candidate match is
+     checked. */
+  memset (work->table, 0, sizeof work->table);
+  while (end - ip >= LZ_MIN_MATCH)
+    {
+      uint32_t x = read32 (ip);
+      unsigned h = hash4 (x);
+      const uint8_t *ref = src + work->table[h];
+
+      work->table[h] = ip - src;
+      if (ref < ip && read32 (ref) == x)
+        {
+          size_t len = LZ_MIN_MATCH;
+          while (ip + len < end && ref[len] == ip[len])
+            len++;
+          if (!put_sequence (&op, oend, anchor, ip - anchor, ip - ref, len))
+            return 0;
+          ip += len;
+          anchor = ip;
+        }
+      else
+        ip++;
+    }
+
+  if (!put_sequence (&op, oend, anchor, end - anchor, 0, 0))
+    return 0;
+  return op - dst;
+}
+
+/* Reads a length extension from *IP, which must not pass IEND,
+   and adds it to *LENGTH.  Returns false if the input ends
+   first. */
+static bool
+get_length (const uint8_t **ip, const uint8_t *iend, size_t *length)
+{
+  uint8_t b;
+
+  do
+    {
+      if (*ip >= iend)
+        return false;
+      b = *(*ip)++;
+      *length += b;
+    }
+  while (b == 255);
+  return true;
+}
+
+/* Decompresses the SRC_SIZE bytes at SRC, produced by
+   lz_compress(), into DST, which has room for DST_SIZE bytes.
+   Returns the decompressed size, or 0 if SRC is malformed or
+   does not fit. */
+size_t
+lz_decompress (const void *src_, size_t src_size,
+               void *dst_, size_t dst_size)
+{
+  const uint8_t *ip = src_;
+  const uint8_t *iend = ip + src_size;
+  uint8_t *dst = dst_;
+  uint8_t *op = dst;
+  uint8_t *oend = dst + dst_size;
+
+  while (ip < iend)
+    {
+      uint8_t token = *ip++;
+      size_t lit_cnt = token >> 4;
+      size_t offset, match_len;
+
+      /* Literals. */
+      if (lit_cnt == 15 && !get_length (&ip, iend, &lit_cnt))
+        return 0;
+      if ((size_t) (iend - ip) < lit_cnt || (size_t) (oend - op) < lit_cnt)
+        return 0;
+      memcpy (op, ip, lit_cnt);
+      ip += lit_cnt;
+      op += lit_cnt;
+      if (ip == iend)
+        break;
+
+      /* Match, which may overlap its own output. */
+      if (iend - ip < 2)
+        return 0;
+      offset = ip[0] | (ip[1] << 8);
+      ip += 2;
+      match_len = token & 15;
+      if (match_len == 15 && !get_length (&ip, iend, &match_len))
+        return 0;
+      match_len += LZ_MIN_MATCH;
+      if (offset == 0 || offset > (size_t) (op - dst)
+          || (size_t) (oend - op) < match_len)
+        return 0;
+      for (; match_len > 0; match_len--, op++)
+        *op = op[-offset];
+    }
+  return op - dst;
+}
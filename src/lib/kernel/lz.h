@@ -0,0 +1,38 @@
+#ifndef __LIB_KERNEL_LZ_H
+#define __LIB_KERNEL_LZ_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* LZ77-family compression of small blocks, such as pages.
+
+   The compressed form is a series of sequences, each a token
+   byte, a run of literal bytes, and a back-reference to a
+   previous match of at least LZ_MIN_MATCH bytes.  The high
+   nibble of the token gives the number of literals, the low
+   nibble the match length minus LZ_MIN_MATCH; a nibble of 15 is
+   extended by following bytes, each added to it, up to and
+   including the first byte that is not 255.  The literals
+   follow the token and any literal length extension, then comes
+   the match offset as 2 bytes, little-endian, then any match
+   length extension.  The last sequence has no match.
+
+   This is essentially the LZ4 block format, which is fast to
+   compress and very fast to decompress. */
+
+/* Shortest match that is worth encoding. */
+#define LZ_MIN_MATCH 4
+
+/* Hash table used by the compressor to find matches. */
+#define LZ_HASH_BITS 10
+struct lz_work
+  {
+    uint16_t table[1 << LZ_HASH_BITS];
+  };
+
+size_t lz_compress (const void *src, size_t src_size,
+                    void *dst, size_t dst_size, struct lz_work *);
+size_t lz_decompress (const void *src, size_t src_size,
+                      void *dst, size_t dst_size);
+
+#endif /* lib/kernel/lz.h */
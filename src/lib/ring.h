@@ -0,0 +1,106 @@
+#ifndef __LIB_RING_H
+#define __LIB_RING_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Submission and completion rings for batched, asynchronous
+   file system calls.
+
+   ring_setup() maps a struct ring_area into the calling process,
+   shared with a kernel worker thread.  The process describes
+   operations in entries in the submission queue, and ring_enter()
+   hands them to the worker, which carries them out in batches
+   and posts a completion queue entry for each.  One ring_enter()
+   call can thus submit and reap many operations.
+
+   Each queue is an array of RING_ENTRIES entries indexed by
+   free-running head and tail counters, taken modulo
+   RING_ENTRIES.  The producer writes an entry and then advances
+   the tail; the consumer reads the entry at the head and then
+   advances the head.  The process produces submissions and
+   consumes completions, and the kernel the reverse.
+
+   Data for reads and writes, and the names of files to open,
+   must lie in the area's buffer, since the worker cannot get at
+   the rest of the process's memory. */
+
+/* Entries in each queue.  Must be a power of 2. */
+#define RING_ENTRIES 64
+
+/* Size of the buffer in a struct ring_area, in bytes. */
+#define RING_BUF_SIZE (8 * 4096)
+
+/* Ring operations. */
+enum ring_op
+  {
+    RING_NOP,                   /* Do nothing. */
+    RING_OPEN,                  /* Open the file named at BUF. */
+    RING_CLOSE,                 /* Close FD. */
+    RING_READ,                  /* Read LEN bytes from FD into BUF. */
+    RING_WRITE                  /* Write LEN bytes at BUF to FD. */
+  };
+
+/* A submission queue entry. */
+struct ring_sqe
+  {
+    int op;                     /* A RING_* operation. */
+    int fd;                     /* File descriptor. */
+    int pos;                    /* File offset, or -1 for position. */
+    unsigned buf;               /* Offset of data in ring's buffer. */
+    unsigned len;               /* Length of data in bytes. */
+    unsigned user_data;         /* Copied to the completion. */
+  };
+
+/* A completion queue entry. */
+struct ring_cqe
+  {
+    unsigned user_data;         /* From the submission. */
+    int result;                 /* As for the equivalent system call. */
+  };
+
+/* Memory shared between a process and its ring worker. */
+struct ring_area
+  {
+    volatile unsigned sq_head;  /* Next submission to execute. */
+    volatile unsigned sq_tail;  /* Next free submission entry. */
+    volatile unsigned cq_head;  /* Next completion to reap. */
+    volatile unsigned cq_tail;  /* Next free completion entry. */
+    struct ring_sqe sq[RING_ENTRIES];
+    struct ring_cqe cq[RING_ENTRIES];
+    uint8_t buf[RING_BUF_SIZE] __attribute__ ((aligned (4096)));
+  };
+
+/* Adds a copy of SQE to RING's submission queue and returns true,
+   or returns false if the queue is full. */
+static inline bool
+ring_push (struct ring_area *ring, const struct ring_sqe *sqe)
+{
+  unsigned tail = ring->sq_tail;
+
+  if (tail - ring->sq_head >= RING_ENTRIES)
+    return false;
+  ring->sq[tail % RING_ENTRIES] = *sqe;
+  asm volatile ("" : : : "memory");
+  ring->sq_tail = tail + 1;
+  return true;
+}
+
+/* Removes the oldest entry from RING's completion queue, copies
+   it to CQE, and returns true, or returns false if the queue is
+   empty. */
+static inline bool
+ring_pop (struct ring_area *ring, struct ring_cqe *cqe)
+{
+  unsigned head = ring->cq_head;
+
+  if (head == ring->cq_tail)
+    return false;
+  asm volatile ("" : : : "memory");
+  *cqe = ring->cq[head % RING_ENTRIES];
+  asm volatile ("" : : : "memory");
+  ring->cq_head = head + 1;
+  return true;
+}
+
+#endif /* lib/ring.h */
@@ -28,7 +28,22 @@ enum
     SYS_MKDIR,                  /* Create a directory. */
     SYS_READDIR,                /* Reads a directory entry. */
     SYS_ISDIR,                  /* Tests if a fd represents a directory. */
-    SYS_INUMBER                 /* Returns the inode number for a fd. */
+    SYS_INUMBER,                /* Returns the inode number for a fd. */
+
+    /* Extensions. */
+    SYS_FORK,                   /* Duplicate this process. */
+    SYS_VM_USAGE,               /* Report virtual memory usage. */
+    SYS_DUP,                    /* Duplicate a file descriptor. */
+    SYS_DUP2,                   /* Duplicate onto a given descriptor. */
+    SYS_READV,                  /* Read into several buffers. */
+    SYS_WRITEV,                 /* Write from several buffers. */
+    SYS_PREAD,                  /* Read at a given offset. */
+    SYS_PWRITE,                 /* Write at a given offset. */
+    SYS_COPY_FILE,              /* Copy between files in the kernel. */
+    SYS_RING_SETUP,             /* Set up submission rings. */
+    SYS_RING_ENTER,             /* Submit and reap ring entries. */
+    SYS_TRACE,                  /* Start or stop tracing system calls. */
+    SYS_SBRK                    /* Grow or shrink the heap. */
   };
 
 #endif /* lib/syscall-nr.h */
@@ -0,0 +1,571 @@
+#include <stdlib.h>
+#include <debug.h>
+#include <limits.h>
+#include <round.h>
+#include <stdint.h>
+#include <string.h>
+#include <syscall.h>
+
+/* User memory allocator.
+
+   Memory comes from the heap, which sbrk() grows in steps of
+   HEAP_GROW bytes.  The heap is divided into "chunks", each a
+   header followed by the block of memory it holds.  A chunk's
+   header records its size and whether it and the chunk before
+   it are in use, and a free chunk's size is repeated at the
+   start of the next chunk.  So a chunk that is freed can find
+   both neighbors and merge with those that are free, which keeps
+   free memory from fragmenting into unusably small pieces.  A
+   "fence" header, of a zero-sized chunk that is always in use,
+   ends the heap.
+
+   Requests of up to SMALL_MAX bytes, which are by far the most
+   common, are rounded up to a power of 2 and served from a free
+   list for that size class, without searching or merging
+   anything.  When a class's list is empty, a chunk of SLAB_SIZE
+   bytes, called a "slab", is taken from the heap and carved into
+   blocks of the class.  A block freed goes back to its class's
+   list.  Once all of a slab's blocks are free, and the class has
+   at least another slab's worth of free blocks, the slab goes
+   back to the heap.  A process has only one thread, so these
+   lists do what per-thread caches do in a multithreaded
+   allocator with no need for locking.
+
+   Larger requests are served from the heap directly.  Free
+   chunks are kept in bins by size, a bin for each power of 2, so
+   that finding a chunk that is big enough looks at one bin's
+   chunks at most and otherwise takes the first chunk from the
+   next nonempty bin.  A chunk bigger than needed is split.  When
+   the free chunk at the end of the heap grows beyond
+   TRIM_THRESHOLD bytes, it is given back with sbrk(). */
+
+/* A chunk.  Only the first two members are present in a chunk
+   in use, the block beginning where NEXT would be.  Free small
+   blocks use NEXT and PREV, too, for their class's list. */
+struct chunk
+  {
+    size_t prev_size;           /* Previous chunk's size, if free. */
+    size_t size;                /* Size of this chunk, plus flags. */
+    struct chunk *next;         /* Next free chunk, if free. */
+    struct chunk *prev;         /* Previous free chunk, if free. */
+  };
+
+/* Flags in the low bits of a chunk's SIZE.  A small block's SIZE
+   holds its offset in its slab instead of its size. */
+#define IN_USE 1                /* Chunk is in use. */
+#define PREV_IN_USE 2           /* Previous chunk is in use. */
+#define SMALL 4                 /* Small block, in a slab. */
+#define FLAGS 7
+
+/* Bytes in a chunk before its block. */
+#define OVERHEAD offsetof (struct chunk, next)
+
+/* Alignment of chunks and blocks, and smallest chunk. */
+#define ALIGN 8
+#define MIN_CHUNK sizeof (struct chunk)
+
+/* Size classes, the smallest SMALL_MIN bytes, doubling up to
+   SMALL_MAX bytes. */
+#define SMALL_MIN_LOG 3
+#define SMALL_MIN (1 << SMALL_MIN_LOG)
+#define SMALL_MAX 1024
+#define SMALL_CLASSES 8
+
+/* Largest block, keeping heap growth within what sbrk() can
+   take in its int argument. */
+#define LARGE_MAX (INT_MAX / 2)
+
+/* Size of a slab's block. */
+#define SLAB_SIZE (8192 - OVERHEAD)
+
+/* Heap growth step and trimming threshold. */
+#define HEAP_GROW (64 * 1024)
+#define TRIM_THRESHOLD (4 * HEAP_GROW)
+
+/* Number of bins for free chunks. */
+#define BINS 32
+
+/* A slab, at the start of its chunk's block, followed by the
+   small blocks carved from it. */
+struct slab
+  {
+    int class;                  /* Size class. */
+    size_t free_cnt;            /* Number of free blocks. */
+  };
+
+/* Offset of a slab's first small block. */
+#define SLAB_HEADER ROUND_UP (sizeof (struct slab), ALIGN)
+
+/* A size class. */
+struct size_class
+  {
+    struct chunk *free_list;    /* Free blocks. */
+    size_t free_cnt;            /* Number of free blocks. */
+    size_t slab_blocks;         /* Blocks per slab. */
+  };
+
+static struct size_class classes[SMALL_CLASSES]; /* Size classes. */
+static struct chunk *bins[BINS];                 /* Free chunks. */
+static struct chunk *fence;                      /* End of heap. */
+
+static void *alloc_large (size_t);
+static bool add_slab (int class);
+static void remove_slab (struct slab *);
+static bool grow_heap (size_t size);
+static void trim_heap (struct chunk *);
+static bool extend (struct chunk *, size_t size);
+static void split (struct chunk *, size_t size);
+static struct chunk *free_chunk (struct chunk *);
+static struct chunk *find_free (size_t size);
+static void bin_insert (struct chunk *);
+static void bin_remove (struct chunk *);
+static void push_free (struct chunk **list, struct chunk *);
+static void remove_free (struct chunk **list, struct chunk *);
+
+/* Returns the size of chunk C. */
+static inline size_t
+chunk_size (const struct chunk *c)
+{
+  return c->size & ~FLAGS;
+}
+
+/* Returns the chunk after C. */
+static inline struct chunk *
+next_chunk (const struct chunk *c)
+{
+  return (struct chunk *) ((uint8_t *) c + chunk_size (c));
+}
+
+/* Returns the block in chunk C. */
+static inline void *
+chunk_to_block (struct chunk *c)
+{
+  return (uint8_t *) c + OVERHEAD;
+}
+
+/* Returns the chunk holding BLOCK. */
+static inline struct chunk *
+block_to_chunk (void *block)
+{
+  return (struct chunk *) ((uint8_t *) block - OVERHEAD);
+}
+
+/* Returns the slab that small block C belongs to. */
+static inline struct slab *
+chunk_to_slab (struct chunk *c)
+{
+  return (struct slab *) ((uint8_t *) c - (c->size >> 3));
+}
+
+/* Returns the size of chunk needed for a block of SIZE bytes,
+   which must not exceed LARGE_MAX. */
+static inline size_t
+chunk_size_for (size_t size)
+{
+  size_t need = ROUND_UP (size + OVERHEAD, ALIGN);
+  return need > MIN_CHUNK ? need : MIN_CHUNK;
+}
+
+/* Returns the size class for blocks of SIZE bytes, which must be
+   between 1 and SMALL_MAX. */
+static inline int
+small_class (size_t size)
+{
+  /* Number of bits in SIZE - 1, at least SMALL_MIN_LOG. */
+  unsigned bits = 32 - __builtin_clz ((size - 1) | (SMALL_MIN - 1));
+  return bits - SMALL_MIN_LOG;
+}
+
+/* Returns the block size of size class CLASS. */
+static inline size_t
+class_size (int class)
+{
+  return (size_t) SMALL_MIN << class;
+}
+
+/* Returns the bin for free chunks of SIZE bytes. */
+static inline int
+bin_index (size_t size)
+{
+  return 31 - __builtin_clz (size);
+}
+
+/* Obtains and returns a new block of at least SIZE bytes.
+   Returns a null pointer if SIZE is zero or if memory is not
+   available. */
+void *
+malloc (size_t size)
+{
+  struct size_class *sc;
+  struct chunk *c;
+
+  if (size == 0)
+    return NULL;
+  if (size > SMALL_MAX)
+    return alloc_large (size);
+
+  sc = &classes[small_class (size)];
+  if (sc->free_list == NULL && !add_slab (sc - classes))
+    return NULL;
+  c = sc->free_list;
+  remove_free (&sc->free_list, c);
+  sc->free_cnt--;
+  chunk_to_slab (c)->free_cnt--;
+  c->size |= IN_USE;
+  return chunk_to_block (c);
+}
+
+/* Allocates and returns A times B bytes initialized to zeroes.
+   Returns a null pointer if memory is not available. */
+void *
+calloc (size_t a, size_t b)
+{
+  void *p;
+
+  /* Check for overflow. */
+  if (b != 0 && a > SIZE_MAX / b)
+    return NULL;
+
+  p = malloc (a * b);
+  if (p != NULL)
+    memset (p, 0, a * b);
+  return p;
+}
+
+/* Attempts to resize OLD_BLOCK to NEW_SIZE bytes, possibly
+   moving it in the process.
+   If successful, returns the new block; on failure, returns a
+   null pointer.
+   A call with null OLD_BLOCK is equivalent to malloc(NEW_SIZE).
+   A call with zero NEW_SIZE is equivalent to free(OLD_BLOCK). */
+void *
+realloc (void *old_block, size_t new_size)
+{
+  struct chunk *c;
+  size_t old_size;
+  void *new_block;
+
+  if (old_block == NULL)
+    return malloc (new_size);
+  if (new_size == 0)
+    {
+      free (old_block);
+      return NULL;
+    }
+
+  c = block_to_chunk (old_block);
+  ASSERT (c->size & IN_USE);
+  if (c->size & SMALL)
+    {
+      old_size = class_size (chunk_to_slab (c)->class);
+      if (new_size <= old_size)
+        return old_block;
+    }
+  else
+    {
+      /* A large block stays where it is if it shrinks, or if it
+         can grow into a free chunk after it. */
+      old_size = chunk_size (c) - OVERHEAD;
+      if (new_size > SMALL_MAX && new_size <= LARGE_MAX)
+        {
+          size_t need = chunk_size_for (new_size);
+          if (need <= chunk_size (c))
+            {
+              split (c, need);
+              return old_block;
+            }
+          else if (extend (c, need))
+            return old_block;
+        }
+    }
+
+  new_block = malloc (new_size);
+  if (new_block != NULL)
+    {
+      memcpy (new_block, old_block,
+              old_size < new_size ? old_size : new_size);
+      free (old_block);
+    }
+  return new_block;
+}
+
+/* Frees block P, which must have been previously allocated with
+   malloc(), calloc(), or realloc(). */
+void
+free (void *p)
+{
+  struct chunk *c;
+
+  if (p == NULL)
+    return;
+
+  c = block_to_chunk (p);
+  ASSERT (c->size & IN_USE);
+  if (c->size & SMALL)
+    {
+      struct slab *s = chunk_to_slab (c);
+      struct size_class *sc = &classes[s->class];
+
+      c->size &= ~IN_USE;
+      push_free (&sc->free_list, c);
+      sc->free_cnt++;
+      if (++s->free_cnt == sc->slab_blocks
+          && sc->free_cnt >= 2 * sc->slab_blocks)
+        remove_slab (s);
+    }
+  else
+    trim_heap (free_chunk (c));
+}
+
+/* Allocates a block of SIZE bytes, more than SMALL_MAX, from
+   the heap.  Returns a null pointer if memory is not
+   available. */
+static void *
+alloc_large (size_t size)
+{
+  struct chunk *c;
+  size_t need;
+
+  if (size > LARGE_MAX)
+    return NULL;
+  need = chunk_size_for (size);
+
+  c = find_free (need);
+  if (c == NULL)
+    {
+      if (!grow_heap (need))
+        return NULL;
+      c = find_free (need);
+      ASSERT (c != NULL);
+    }
+
+  bin_remove (c);
+  c->size |= IN_USE;
+  next_chunk (c)->size |= PREV_IN_USE;
+  split (c, need);
+  return chunk_to_block (c);
+}
+
+/* Carves a new slab into blocks of size class CLASS and adds
+   them to the class's free list.  Returns true if successful,
+   false if memory is not available. */
+static bool
+add_slab (int class)
+{
+  struct size_class *sc = &classes[class];
+  size_t size = class_size (class) + OVERHEAD;
+  struct slab *s;
+  size_t i;
+
+  s = alloc_large (SLAB_SIZE);
+  if (s == NULL)
+    return false;
+  if (sc->slab_blocks == 0)
+    sc->slab_blocks = (SLAB_SIZE - SLAB_HEADER) / size;
+
+  s->class = class;
+  s->free_cnt = sc->slab_blocks;
+  for (i = 0; i < sc->slab_blocks; i++)
+    {
+      size_t ofs = SLAB_HEADER + i * size;
+      struct chunk *c = (struct chunk *) ((uint8_t *) s + ofs);
+      c->size = (ofs << 3) | SMALL;
+      push_free (&sc->free_list, c);
+    }
+  sc->free_cnt += sc->slab_blocks;
+  return true;
+}
+
+/* Removes slab S, all of whose blocks are free, from its class
+   and returns it to the heap. */
+static void
+remove_slab (struct slab *s)
+{
+  struct size_class *sc = &classes[s->class];
+  size_t size = class_size (s->class) + OVERHEAD;
+  size_t i;
+
+  for (i = 0; i < sc->slab_blocks; i++)
+    remove_free (&sc->free_list,
+            (struct chunk *) ((uint8_t *) s + SLAB_HEADER + i * size));
+  sc->free_cnt -= sc->slab_blocks;
+  trim_heap (free_chunk (block_to_chunk (s)));
+}
+
+/* Grows the heap by enough to hold a chunk of SIZE bytes and
+   adds the new memory to the free chunks.  Returns true if
+   successful, false if sbrk() fails. */
+static bool
+grow_heap (size_t size)
+{
+  size_t increment = ROUND_UP (size + 2 * OVERHEAD, HEAP_GROW);
+  uint8_t *start = sbrk (increment);
+  uint8_t *end = start + increment;
+  struct chunk *c;
+
+  if (start == (uint8_t *) -1)
+    return false;
+
+  if (fence != NULL && start == (uint8_t *) fence + OVERHEAD)
+    {
+      /* The new memory follows the heap, so the fence becomes
+         the header of a chunk that reaches the new end. */
+      c = fence;
+      c->size = increment | (c->size & PREV_IN_USE) | IN_USE;
+    }
+  else
+    {
+      /* The first memory, or something else moved the break:
+         start afresh.  Nothing precedes the first chunk. */
+      c = (struct chunk *) ROUND_UP ((uintptr_t) start, ALIGN);
+      c->size = (ROUND_DOWN (end - (uint8_t *) c - OVERHEAD, ALIGN)
+                 | IN_USE | PREV_IN_USE);
+    }
+  fence = next_chunk (c);
+  fence->size = IN_USE;
+  ASSERT ((uint8_t *) fence + OVERHEAD <= end);
+
+  free_chunk (c);
+  return true;
+}
+
+/* If free chunk C is the last in the heap and bigger than
+   TRIM_THRESHOLD, and nothing else has moved the break, gives
+   the end of it back to the system. */
+static void
+trim_heap (struct chunk *c)
+{
+  size_t release;
+
+  if (next_chunk (c) != fence || chunk_size (c) < TRIM_THRESHOLD
+      || sbrk (0) != (uint8_t *) fence + OVERHEAD)
+    return;
+
+  release = ROUND_DOWN (chunk_size (c) - HEAP_GROW, HEAP_GROW);
+  bin_remove (c);
+  c->size -= release;
+  bin_insert (c);
+  fence = next_chunk (c);
+  fence->prev_size = chunk_size (c);
+  fence->size = IN_USE;
+  sbrk (-(int) release);
+}
+
+/* Tries to grow chunk C, which is in use, to SIZE bytes by
+   merging it with the free chunk that follows it, if any.
+   Returns true if successful, false if there is no such chunk
+   or it is too small. */
+static bool
+extend (struct chunk *c, size_t size)
+{
+  struct chunk *next = next_chunk (c);
+
+  if (next->size & IN_USE || chunk_size (c) + chunk_size (next) < size)
+    return false;
+
+  bin_remove (next);
+  c->size += chunk_size (next);
+  next_chunk (c)->size |= PREV_IN_USE;
+  split (c, size);
+  return true;
+}
+
+/* Shrinks chunk C, which is in use, to SIZE bytes, freeing the
+   rest as a chunk of its own if it is big enough. */
+static void
+split (struct chunk *c, size_t size)
+{
+  struct chunk *rest;
+
+  if (chunk_size (c) - size < MIN_CHUNK)
+    return;
+
+  rest = (struct chunk *) ((uint8_t *) c + size);
+  rest->size = (chunk_size (c) - size) | IN_USE | PREV_IN_USE;
+  c->size = size | (c->size & FLAGS);
+  free_chunk (rest);
+}
+
+/* Frees chunk C, which is in use, merging it with free chunks
+   before and after it.  Returns the merged chunk. */
+static struct chunk *
+free_chunk (struct chunk *c)
+{
+  struct chunk *next = next_chunk (c);
+  size_t size = chunk_size (c);
+
+  if (!(next->size & IN_USE))
+    {
+      bin_remove (next);
+      size += chunk_size (next);
+    }
+  if (!(c->size & PREV_IN_USE))
+    {
+      c = (struct chunk *) ((uint8_t *) c - c->prev_size);
+      bin_remove (c);
+      size += chunk_size (c);
+    }
+
+  /* Free chunks never border each other, so the chunk before C
+     is in use. */
+  c->size = size | PREV_IN_USE;
+  next = next_chunk (c);
+  next->prev_size = size;
+  next->size &= ~PREV_IN_USE;
+  bin_insert (c);
+  return c;
+}
+
+/* Returns a free chunk of at least SIZE bytes, or a null
+   pointer if there is none. */
+static struct chunk *
+find_free (size_t size)
+{
+  int bin = bin_index (size);
+  struct chunk *c;
+
+  for (c = bins[bin]; c != NULL; c = c->next)
+    if (chunk_size (c) >= size)
+      return c;
+  for (bin++; bin < BINS; bin++)
+    if (bins[bin] != NULL)
+      return bins[bin];
+  return NULL;
+}
+
+/* Adds free chunk C to its bin. */
+static void
+bin_insert (struct chunk *c)
+{
+  push_free (&bins[bin_index (chunk_size (c))], c);
+}
+
+/* Removes free chunk C from its bin. */
+static void
+bin_remove (struct chunk *c)
+{
+  remove_free (&bins[bin_index (chunk_size (c))], c);
+}
+
+/* Adds C to the front of free LIST. */
+static void
+push_free (struct chunk **list, struct chunk *c)
+{
+  c->prev = NULL;
+  c->next = *list;
+  if (*list != NULL)
+    (*list)->prev = c;
+  *list = c;
+}
+
+/* Removes C from free LIST. */
+static void
+remove_free (struct chunk **list, struct chunk *c)
+{
+  if (c->prev != NULL)
+    c->prev->next = c->next;
+  else
+    *list = c->next;
+  if (c->next != NULL)
+    c->next->prev = c->prev;
+}
@@ -4,4 +4,47 @@
 int hprintf (int, const char *, ...) PRINTF_FORMAT (2, 3);
 int vhprintf (int, const char *, va_list) PRINTF_FORMAT (2, 0);
 
+/* Buffered streams. */
+typedef struct FILE FILE;
+
+/* Standard streams.  Output to stdout is line buffered, output
+   to stderr is unbuffered.  Both go to the console, which has
+   only the one output handle.  Input from stdin is unbuffered,
+   because reading the console blocks until every byte asked for
+   has been typed. */
+extern FILE *stdin;
+extern FILE *stdout;
+extern FILE *stderr;
+
+#define EOF (-1)                /* End of file or error. */
+#define BUFSIZ 512              /* Default buffer size. */
+#define FOPEN_MAX 8             /* Most streams open at once. */
+
+/* Buffering modes for setvbuf(). */
+#define _IOFBF 0                /* Fully buffered. */
+#define _IOLBF 1                /* Line buffered. */
+#define _IONBF 2                /* Unbuffered. */
+
+FILE *fopen (const char *name, const char *mode);
+FILE *fdopen (int handle, const char *mode);
+int fclose (FILE *);
+int fflush (FILE *);
+int setvbuf (FILE *, char *buf, int mode, size_t size);
+int fileno (FILE *);
+int feof (FILE *);
+int ferror (FILE *);
+
+size_t fread (void *, size_t size, size_t cnt, FILE *);
+size_t fwrite (const void *, size_t size, size_t cnt, FILE *);
+int fgetc (FILE *);
+char *fgets (char *, int size, FILE *);
+int fputc (int, FILE *);
+int fputs (const char *, FILE *);
+int fprintf (FILE *, const char *, ...) PRINTF_FORMAT (2, 3);
+int vfprintf (FILE *, const char *, va_list) PRINTF_FORMAT (2, 0);
+
+#define getc(STREAM) fgetc (STREAM)
+#define putc(C, STREAM) fputc (C, STREAM)
+#define getchar() fgetc (stdin)
+
 #endif /* lib/user/stdio.h */
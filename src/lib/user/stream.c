@@ -0,0 +1,545 @@
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+
+/* Buffered streams.
+
+   Each stream has one buffer, which holds either input read
+   ahead from the file or output not yet written to it, never
+   both.  Switching a stream from writing to reading writes out
+   its buffer; switching from reading to writing seeks back over
+   input read ahead but not consumed, and discards it.
+
+   A fully buffered stream writes its buffer out only when it
+   fills up, when fflush() or fclose() is called, or when the
+   process exits.  A line buffered stream also writes it out at
+   the end of any fwrite() (or fprintf(), or...) whose data
+   contains a new-line.  An unbuffered stream passes each
+   fwrite() straight to write() and reads one byte at a time.
+   Writes too large for the buffer bypass it either way.
+
+   The streams and their default buffers are allocated
+   statically, FOPEN_MAX of them, so that programs that only
+   print do not need a heap. */
+
+/* What a stream's buffer holds. */
+enum stream_state
+  {
+    IDLE,                       /* Nothing. */
+    READING,                    /* Input read ahead. */
+    WRITING                     /* Output not yet written. */
+  };
+
+/* A stream. */
+struct FILE
+  {
+    bool in_use;                /* Open? */
+    int handle;                 /* File descriptor. */
+    bool readable;              /* Open for reading? */
+    bool writable;              /* Open for writing? */
+    int mode;                   /* _IOFBF, _IOLBF, or _IONBF. */
+    enum stream_state state;    /* What BUF holds. */
+    char *buf;                  /* Buffer, or null for OWN_BUF. */
+    size_t size;                /* Size of BUF. */
+    size_t ofs;                 /* Offset of next input in BUF. */
+    size_t len;                 /* Bytes of data in BUF. */
+    bool eof;                   /* End of file reached? */
+    bool error;                 /* Error occurred? */
+    char own_buf[BUFSIZ];       /* Default buffer. */
+  };
+
+static FILE streams[FOPEN_MAX] =
+  {
+    {.in_use = true, .handle = STDIN_FILENO, .readable = true,
+     .mode = _IONBF},
+    {.in_use = true, .handle = STDOUT_FILENO, .writable = true,
+     .mode = _IOLBF},
+    {.in_use = true, .handle = STDOUT_FILENO, .writable = true,
+     .mode = _IONBF},
+  };
+
+FILE *stdin = &streams[0];
+FILE *stdout = &streams[1];
+FILE *stderr = &streams[2];
+
+static bool parse_mode (const char *, bool *readable, bool *writable,
+                        bool *append);
+static bool begin_read (FILE *);
+static bool begin_write (FILE *);
+static bool fill (FILE *);
+static bool flush_output (FILE *);
+static void drop_input (FILE *);
+static size_t write_all (FILE *, const char *, size_t);
+
+/* Opens the file named NAME as a stream and returns it, or
+   returns a null pointer if the file cannot be opened or MODE is
+   invalid.  MODE is "r" for reading, "w" for writing, or "a" for
+   writing at the end of the file, optionally followed by "+" to
+   open for both.  Pintos files have a fixed size, given when
+   they are created with create(), so unlike the standard
+   fopen(), "w" and "a" neither create nor truncate the file. */
+FILE *
+fopen (const char *name, const char *mode) 
+{
+  bool readable, writable, append;
+  int handle;
+  FILE *stream;
+
+  if (!parse_mode (mode, &readable, &writable, &append))
+    return NULL;
+  handle = open (name);
+  if (handle < 0)
+    return NULL;
+  stream = fdopen (handle, mode);
+  if (stream == NULL)
+    close (handle);
+  return stream;
+}
+
+/* Returns a new stream for file descriptor HANDLE, opened with
+   MODE as for fopen(), or a null pointer if MODE is invalid or
+   FOPEN_MAX streams are already open.  Streams on files are
+   fully buffered, streams on the console line buffered for
+   output and unbuffered for input. */
+FILE *
+fdopen (int handle, const char *mode) 
+{
+  bool readable, writable, append;
+  FILE *stream;
+
+  if (!parse_mode (mode, &readable, &writable, &append))
+    return NULL;
+  for (stream = streams; stream < streams + FOPEN_MAX; stream++)
+    if (!stream->in_use)
+      {
+        memset (stream, 0, sizeof *stream);
+        stream->in_use = true;
+        stream->handle = handle;
+        stream->readable = readable;
+        stream->writable = writable;
+        if (handle == STDIN_FILENO)
+          stream->mode = _IONBF;
+        else if (handle == STDOUT_FILENO)
+          stream->mode = _IOLBF;
+        else
+          stream->mode = _IOFBF;
+        if (append)
+          seek (handle, filesize (handle));
+        return stream;
+      }
+  return NULL;
+}
+
+/* Flushes and closes STREAM, and closes its file descriptor
+   unless it is the console's.  Returns 0 if successful, EOF if
+   writing out buffered output failed. */
+int
+fclose (FILE *stream) 
+{
+  int retval = fflush (stream);
+
+  if (stream->handle != STDIN_FILENO && stream->handle != STDOUT_FILENO)
+    close (stream->handle);
+  stream->in_use = false;
+  return retval;
+}
+
+/* Writes out STREAM's buffered output, or discards its buffered
+   input, or does the same for every open stream if STREAM is a
+   null pointer.  Returns 0 if successful, EOF if writing failed. */
+int
+fflush (FILE *stream) 
+{
+  int retval = 0;
+
+  if (stream == NULL)
+    {
+      for (stream = streams; stream < streams + FOPEN_MAX; stream++)
+        if (stream->in_use && fflush (stream) == EOF)
+          retval = EOF;
+    }
+  else if (stream->state == WRITING)
+    {
+      if (!flush_output (stream))
+        retval = EOF;
+    }
+  else if (stream->state == READING)
+    drop_input (stream);
+  return retval;
+}
+
+/* Sets STREAM's buffering MODE to _IOFBF, _IOLBF, or _IONBF.
+   Unless MODE is _IONBF, STREAM uses BUF, of SIZE bytes, as its
+   buffer if BUF is nonnull, and otherwise its default buffer,
+   limited to SIZE bytes if SIZE is nonzero.  Returns 0 if
+   successful, nonzero if MODE is invalid. */
+int
+setvbuf (FILE *stream, char *buf, int mode, size_t size) 
+{
+  if (mode != _IOFBF && mode != _IOLBF && mode != _IONBF)
+    return EOF;
+  fflush (stream);
+  stream->mode = mode;
+  if (buf != NULL && size > 0 && mode != _IONBF)
+    {
+      stream->buf = buf;
+      stream->size = size;
+    }
+  else
+    {
+      stream->buf = NULL;
+      stream->size = size > 0 && size < BUFSIZ ? size : BUFSIZ;
+    }
+  return 0;
+}
+
+/* Returns STREAM's file descriptor. */
+int
+fileno (FILE *stream) 
+{
+  return stream->handle;
+}
+
+/* Returns nonzero if reading STREAM has reached end of file. */
+int
+feof (FILE *stream) 
+{
+  return stream->eof;
+}
+
+/* Returns nonzero if an error has occurred on STREAM. */
+int
+ferror (FILE *stream) 
+{
+  return stream->error;
+}
+
+/* Reads up to CNT items of SIZE bytes each from STREAM into
+   BUFFER.  Returns the number of whole items read, which is less
+   than CNT only at end of file or on error. */
+size_t
+fread (void *buffer_, size_t size, size_t cnt, FILE *stream) 
+{
+  char *buffer = buffer_;
+  size_t total = size * cnt;
+  size_t done = 0;
+
+  if (total == 0 || !begin_read (stream))
+    return 0;
+  while (done < total)
+    {
+      size_t avail = stream->len - stream->ofs;
+
+      if (avail > 0)
+        {
+          size_t n = total - done < avail ? total - done : avail;
+          memcpy (buffer + done, stream->buf + stream->ofs, n);
+          stream->ofs += n;
+          done += n;
+        }
+      else if (total - done >= stream->size && stream->mode != _IONBF)
+        {
+          /* Too much to bother buffering. */
+          int n = read (stream->handle, buffer + done, total - done);
+          if (n <= 0)
+            {
+              stream->eof = n == 0;
+              stream->error = n < 0;
+              break;
+            }
+          done += n;
+        }
+      else if (!fill (stream))
+        break;
+    }
+  return done / size;
+}
+
+/* Writes CNT items of SIZE bytes each from BUFFER to STREAM.
+   Returns the number of items written, which is less than CNT
+   only on error. */
+size_t
+fwrite (const void *buffer_, size_t size, size_t cnt, FILE *stream) 
+{
+  const char *buffer = buffer_;
+  size_t total = size * cnt;
+  size_t done = 0;
+
+  if (total == 0 || !begin_write (stream))
+    return 0;
+  if (stream->mode == _IONBF || total >= stream->size)
+    {
+      if (flush_output (stream))
+        done = write_all (stream, buffer, total);
+    }
+  else
+    {
+      while (done < total)
+        {
+          size_t room = stream->size - stream->len;
+          size_t n = total - done < room ? total - done : room;
+
+          memcpy (stream->buf + stream->len, buffer + done, n);
+          stream->len += n;
+          done += n;
+          if (stream->len == stream->size && !flush_output (stream))
+            break;
+        }
+      if (stream->mode == _IOLBF && memchr (buffer, '\n', total) != NULL)
+        flush_output (stream);
+    }
+  return done / size;
+}
+
+/* Reads and returns the next byte from STREAM, or returns EOF at
+   end of file or on error. */
+int
+fgetc (FILE *stream) 
+{
+  if (!begin_read (stream)
+      || (stream->ofs == stream->len && !fill (stream)))
+    return EOF;
+  return (unsigned char) stream->buf[stream->ofs++];
+}
+
+/* Reads a line from STREAM into BUFFER, which has room for SIZE
+   bytes, stopping after a new-line, which is kept, or when
+   BUFFER is full, and null-terminates it.  Returns BUFFER, or a
+   null pointer if end of file or an error came before any byte
+   was read. */
+char *
+fgets (char *buffer, int size, FILE *stream) 
+{
+  int i = 0;
+
+  if (size <= 0)
+    return NULL;
+  while (i < size - 1)
+    {
+      int c = fgetc (stream);
+      if (c == EOF)
+        break;
+      buffer[i++] = c;
+      if (c == '\n')
+        break;
+    }
+  if (i == 0 && size > 1)
+    return NULL;
+  buffer[i] = '\0';
+  return buffer;
+}
+
+/* Writes C, as an unsigned char, to STREAM.  Returns C, or EOF
+   on error. */
+int
+fputc (int c, FILE *stream) 
+{
+  unsigned char byte = c;
+  return fwrite (&byte, 1, 1, stream) == 1 ? byte : EOF;
+}
+
+/* Writes string S to STREAM, without a new-line.  Returns 0 if
+   successful, EOF on error. */
+int
+fputs (const char *s, FILE *stream) 
+{
+  size_t length = strlen (s);
+  return length == 0 || fwrite (s, length, 1, stream) == 1 ? 0 : EOF;
+}
+
+/* Like printf(), but writes output to STREAM. */
+int
+fprintf (FILE *stream, const char *format, ...) 
+{
+  va_list args;
+  int retval;
+
+  va_start (args, format);
+  retval = vfprintf (stream, format, args);
+  va_end (args);
+
+  return retval;
+}
+
+/* Auxiliary data for vfprintf(). */
+struct vfprintf_aux 
+  {
+    char buf[64];       /* Character buffer. */
+    char *p;            /* Current position in buffer. */
+    int char_cnt;       /* Total characters written so far. */
+    FILE *stream;       /* Output stream. */
+  };
+
+static void add_char (char, void *);
+static void flush_aux (struct vfprintf_aux *);
+
+/* Like vprintf(), but writes output to STREAM.  The output is
+   gathered into chunks before it goes to the stream, so that an
+   unbuffered stream does not write a byte at a time. */
+int
+vfprintf (FILE *stream, const char *format, va_list args) 
+{
+  struct vfprintf_aux aux;
+  aux.p = aux.buf;
+  aux.char_cnt = 0;
+  aux.stream = stream;
+  __vprintf (format, args, add_char, &aux);
+  flush_aux (&aux);
+  return aux.char_cnt;
+}
+
+/* Adds C to the buffer in AUX, flushing it if the buffer fills
+   up. */
+static void
+add_char (char c, void *aux_) 
+{
+  struct vfprintf_aux *aux = aux_;
+  *aux->p++ = c;
+  if (aux->p >= aux->buf + sizeof aux->buf)
+    flush_aux (aux);
+  aux->char_cnt++;
+}
+
+/* Passes the buffer in AUX on to its stream. */
+static void
+flush_aux (struct vfprintf_aux *aux)
+{
+  if (aux->p > aux->buf)
+    fwrite (aux->buf, 1, aux->p - aux->buf, aux->stream);
+  aux->p = aux->buf;
+}
+
+/* Parses MODE, as for fopen(), into *READABLE, *WRITABLE, and
+   *APPEND.  Returns true if successful, false if MODE is
+   invalid. */
+static bool
+parse_mode (const char *mode, bool *readable, bool *writable, bool *append) 
+{
+  *readable = *writable = *append = false;
+  switch (mode[0])
+    {
+    case 'r':
+      *readable = true;
+      break;
+    case 'a':
+      *append = true;
+      /* Fall through. */
+    case 'w':
+      *writable = true;
+      break;
+    default:
+      return false;
+    }
+  if (strchr (mode + 1, '+') != NULL)
+    *readable = *writable = true;
+  return true;
+}
+
+/* Prepares STREAM for reading.  Returns true if successful,
+   false if STREAM is not open for reading or writing out its
+   buffered output failed. */
+static bool
+begin_read (FILE *stream) 
+{
+  if (!stream->readable)
+    {
+      stream->error = true;
+      return false;
+    }
+  if (stream->state == WRITING && !flush_output (stream))
+    return false;
+  if (stream->buf == NULL)
+    {
+      stream->buf = stream->own_buf;
+      if (stream->size == 0)
+        stream->size = sizeof stream->own_buf;
+    }
+  stream->state = READING;
+  return true;
+}
+
+/* Prepares STREAM for writing.  Returns true if successful,
+   false if STREAM is not open for writing. */
+static bool
+begin_write (FILE *stream) 
+{
+  if (!stream->writable)
+    {
+      stream->error = true;
+      return false;
+    }
+  if (stream->state == READING)
+    drop_input (stream);
+  if (stream->buf == NULL)
+    {
+      stream->buf = stream->own_buf;
+      if (stream->size == 0)
+        stream->size = sizeof stream->own_buf;
+    }
+  stream->state = WRITING;
+  return true;
+}
+
+/* Refills STREAM's empty buffer with input.  Returns true if
+   successful, false at end of file or on error. */
+static bool
+fill (FILE *stream) 
+{
+  int n = read (stream->handle, stream->buf,
+                stream->mode == _IONBF ? 1 : stream->size);
+  if (n <= 0)
+    {
+      stream->eof = n == 0;
+      stream->error = n < 0;
+      return false;
+    }
+  stream->ofs = 0;
+  stream->len = n;
+  return true;
+}
+
+/* Writes out STREAM's buffered output, which is then discarded
+   even if writing fails.  Returns true if successful, false on
+   error. */
+static bool
+flush_output (FILE *stream) 
+{
+  size_t len = stream->len;
+
+  stream->len = 0;
+  return write_all (stream, stream->buf, len) == len;
+}
+
+/* Discards STREAM's buffered input, first seeking back over it
+   so that the file position is where the reader left off. */
+static void
+drop_input (FILE *stream) 
+{
+  size_t unread = stream->len - stream->ofs;
+
+  if (unread > 0 && stream->handle != STDIN_FILENO)
+    seek (stream->handle, tell (stream->handle) - unread);
+  stream->ofs = stream->len = 0;
+  stream->state = IDLE;
+}
+
+/* Writes the SIZE bytes in BUFFER to STREAM's file descriptor.
+   Returns the number of bytes written, which is less than SIZE
+   only on error. */
+static size_t
+write_all (FILE *stream, const char *buffer, size_t size) 
+{
+  size_t done = 0;
+
+  while (done < size)
+    {
+      int n = write (stream->handle, buffer + done, size - done);
+      if (n <= 0)
+        {
+          stream->error = true;
+          break;
+        }
+      done += n;
+    }
+  return done;
+}
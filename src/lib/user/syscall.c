@@ -1,69 +1,102 @@
 #include <syscall.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <kdata.h>
 #include "../syscall-nr.h"
 
-/* Invokes syscall NUMBER, passing no arguments, and returns the
-   return value as an `int'. */
-#define syscall0(NUMBER)                                        \
+/* Returns true if system calls should enter the kernel with
+   SYSENTER, which is faster than int $0x30.  The kernel enables
+   SYSENTER whenever CPUID reports it (the SEP feature flag), so
+   we check the same thing, once. */
+static bool
+use_sysenter (void)
+{
+  static int sep = -1;
+
+  if (sep < 0)
+    {
+      uint32_t eax = 1, ebx, ecx, edx;
+      asm ("cpuid" : "+a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx));
+      sep = (edx & 0x00000800) != 0;
+    }
+  return sep;
+}
+
+/* Enters the kernel for a system call, after instructions PUSH
+   have pushed the call's arguments and number on the stack, pops
+   the SIZE bytes they pushed, and returns the call's return value
+   as an `int'.  The remaining arguments are PUSH's asm operands.
+
+   Both ways into the kernel read the arguments from the stack.
+   SYSENTER also passes the stack pointer in ECX and the address
+   to return to in EDX, which do not survive the call. */
+#define syscall_enter(PUSH, SIZE, ...)                          \
         ({                                                      \
           int retval;                                           \
-          asm volatile                                          \
-            ("pushl %[number]; int $0x30; addl $4, %%esp"       \
-               : "=a" (retval)                                  \
-               : [number] "i" (NUMBER)                          \
-               : "memory");                                     \
+          if (use_sysenter ())                                  \
+            asm volatile                                        \
+              (PUSH "movl %%esp, %%ecx; movl $1f, %%edx; "      \
+               "sysenter; 1: addl $" #SIZE ", %%esp"            \
+                 : "=a" (retval)                                \
+                 : __VA_ARGS__                                  \
+                 : "ecx", "edx", "memory");                     \
+          else                                                  \
+            asm volatile                                        \
+              (PUSH "int $0x30; addl $" #SIZE ", %%esp"         \
+                 : "=a" (retval)                                \
+                 : __VA_ARGS__                                  \
+                 : "memory");                                   \
           retval;                                               \
         })
 
+/* Invokes syscall NUMBER, passing no arguments, and returns the
+   return value as an `int'. */
+#define syscall0(NUMBER)                                        \
+        syscall_enter ("pushl %[number]; ", 4,                  \
+                       [number] "i" (NUMBER))
+
 /* Invokes syscall NUMBER, passing argument ARG0, and returns the
    return value as an `int'. */
-#define syscall1(NUMBER, ARG0)                                           \
-        ({                                                               \
-          int retval;                                                    \
-          asm volatile                                                   \
-            ("pushl %[arg0]; pushl %[number]; int $0x30; addl $8, %%esp" \
-               : "=a" (retval)                                           \
-               : [number] "i" (NUMBER),                                  \
-                 [arg0] "g" (ARG0)                                       \
-               : "memory");                                              \
-          retval;                                                        \
-        })
+#define syscall1(NUMBER, ARG0)                                  \
+        syscall_enter ("pushl %[arg0]; pushl %[number]; ", 8,   \
+                       [number] "i" (NUMBER),                   \
+                       [arg0] "g" (ARG0))
 
 /* Invokes syscall NUMBER, passing arguments ARG0 and ARG1, and
    returns the return value as an `int'. */
 #define syscall2(NUMBER, ARG0, ARG1)                            \
-        ({                                                      \
-          int retval;                                           \
-          asm volatile                                          \
-            ("pushl %[arg1]; pushl %[arg0]; "                   \
-             "pushl %[number]; int $0x30; addl $12, %%esp"      \
-               : "=a" (retval)                                  \
-               : [number] "i" (NUMBER),                         \
-                 [arg0] "r" (ARG0),                             \
-                 [arg1] "r" (ARG1)                              \
-               : "memory");                                     \
-          retval;                                               \
-        })
+        syscall_enter ("pushl %[arg1]; pushl %[arg0]; "         \
+                       "pushl %[number]; ", 12,                 \
+                       [number] "i" (NUMBER),                   \
+                       [arg0] "r" (ARG0),                       \
+                       [arg1] "r" (ARG1))
 
 /* Invokes syscall NUMBER, passing arguments ARG0, ARG1, and
    ARG2, and returns the return value as an `int'. */
 #define syscall3(NUMBER, ARG0, ARG1, ARG2)                      \
-        ({                                                      \
-          int retval;                                           \
-          asm volatile                                          \
-            ("pushl %[arg2]; pushl %[arg1]; pushl %[arg0]; "    \
-             "pushl %[number]; int $0x30; addl $16, %%esp"      \
-               : "=a" (retval)                                  \
-               : [number] "i" (NUMBER),                         \
-                 [arg0] "r" (ARG0),                             \
-                 [arg1] "r" (ARG1),                             \
-                 [arg2] "r" (ARG2)                              \
-               : "memory");                                     \
-          retval;                                               \
-        })
+        syscall_enter ("pushl %[arg2]; pushl %[arg1]; "         \
+                       "pushl %[arg0]; pushl %[number]; ", 16,  \
+                       [number] "i" (NUMBER),                   \
+                       [arg0] "r" (ARG0),                       \
+                       [arg1] "r" (ARG1),                       \
+                       [arg2] "r" (ARG2))
+
+/* Invokes syscall NUMBER, passing arguments ARG0, ARG1, ARG2,
+   and ARG3, and returns the return value as an `int'. */
+#define syscall4(NUMBER, ARG0, ARG1, ARG2, ARG3)                \
+        syscall_enter ("pushl %[arg3]; pushl %[arg2]; "         \
+                       "pushl %[arg1]; pushl %[arg0]; "         \
+                       "pushl %[number]; ", 20,                 \
+                       [number] "i" (NUMBER),                   \
+                       [arg0] "r" (ARG0),                       \
+                       [arg1] "r" (ARG1),                       \
+                       [arg2] "r" (ARG2),                       \
+                       [arg3] "g" (ARG3))
 
 void
 halt (void) 
 {
+  fflush (NULL);
   syscall0 (SYS_HALT);
   NOT_REACHED ();
 }
@@ -71,6 +104,7 @@ halt (void)
 void
 exit (int status)
 {
+  fflush (NULL);
   syscall1 (SYS_EXIT, status);
   NOT_REACHED ();
 }
@@ -114,6 +148,9 @@ filesize (int fd)
 int
 read (int fd, void *buffer, unsigned size)
 {
+  /* Show any prompt before waiting for the user to type. */
+  if (fd == STDIN_FILENO)
+    fflush (stdout);
   return syscall3 (SYS_READ, fd, buffer, size);
 }
 
@@ -182,3 +219,123 @@ inumber (int fd)
 {
   return syscall1 (SYS_INUMBER, fd);
 }
+
+pid_t
+fork (void)
+{
+  return (pid_t) syscall0 (SYS_FORK);
+}
+
+void
+vm_usage (struct vm_usage *usage)
+{
+  syscall1 (SYS_VM_USAGE, usage);
+}
+
+int
+dup (int fd)
+{
+  return syscall1 (SYS_DUP, fd);
+}
+
+int
+dup2 (int fd, int fd2)
+{
+  return syscall2 (SYS_DUP2, fd, fd2);
+}
+
+int
+readv (int fd, const struct iovec *iov, int iovcnt)
+{
+  return syscall3 (SYS_READV, fd, iov, iovcnt);
+}
+
+int
+writev (int fd, const struct iovec *iov, int iovcnt)
+{
+  return syscall3 (SYS_WRITEV, fd, iov, iovcnt);
+}
+
+int
+pread (int fd, void *buffer, unsigned size, unsigned offset)
+{
+  return syscall4 (SYS_PREAD, fd, buffer, size, offset);
+}
+
+int
+pwrite (int fd, const void *buffer, unsigned size, unsigned offset)
+{
+  return syscall4 (SYS_PWRITE, fd, buffer, size, offset);
+}
+
+int
+copy_file (int fd_in, int fd_out, unsigned offset, unsigned length)
+{
+  return syscall4 (SYS_COPY_FILE, fd_in, fd_out, offset, length);
+}
+
+bool
+ring_setup (struct ring_area *ring)
+{
+  return syscall1 (SYS_RING_SETUP, ring);
+}
+
+int
+ring_enter (unsigned min_complete)
+{
+  return syscall1 (SYS_RING_ENTER, min_complete);
+}
+
+bool
+trace (bool enable)
+{
+  return syscall1 (SYS_TRACE, (int) enable);
+}
+
+void *
+sbrk (int increment)
+{
+  return (void *) syscall1 (SYS_SBRK, increment);
+}
+
+/* Sets the end of the heap to END.  Returns 0 if successful, -1
+   on failure. */
+int
+brk (void *end)
+{
+  uint8_t *old_break = sbrk (0);
+  return sbrk ((uint8_t *) end - old_break) != (void *) -1 ? 0 : -1;
+}
+
+/* Returns the number of timer ticks since the OS booted. */
+int64_t
+clock_ticks (void)
+{
+  const struct kdata *k = KDATA_ADDR;
+  unsigned seq;
+  int64_t ticks;
+
+  do
+    {
+      seq = k->seq;
+      asm volatile ("" : : : "memory");
+      ticks = k->ticks;
+      asm volatile ("" : : : "memory");
+    }
+  while ((seq & 1) != 0 || seq != k->seq);
+  return ticks;
+}
+
+/* Returns the number of timer ticks per second. */
+int
+clock_freq (void)
+{
+  return KDATA_ADDR->timer_freq;
+}
+
+/* Returns the running process's pid. */
+pid_t
+getpid (void)
+{
+  return KDATA_ADDR->pid;
+}
@@ -2,7 +2,11 @@
 #define __LIB_USER_SYSCALL_H
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <debug.h>
+#include <iovec.h>
+#include <ring.h>
+#include <vm-usage.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -45,4 +49,25 @@ bool readdir (int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir (int fd);
 int inumber (int fd);
 
+/* Extensions. */
+pid_t fork (void);
+void vm_usage (struct vm_usage *);
+int dup (int fd);
+int dup2 (int fd, int fd2);
+int readv (int fd, const struct iovec *, int iovcnt);
+int writev (int fd, const struct iovec *, int iovcnt);
+int pread (int fd, void *buffer, unsigned length, unsigned offset);
+int pwrite (int fd, const void *buffer, unsigned length, unsigned offset);
+int copy_file (int fd_in, int fd_out, unsigned offset, unsigned length);
+bool ring_setup (struct ring_area *);
+int ring_enter (unsigned min_complete);
+bool trace (bool enable);
+void *sbrk (int increment);
+int brk (void *end);
+
+/* Read from the kernel data page, without a system call. */
+int64_t clock_ticks (void);
+int clock_freq (void);
+pid_t getpid (void);
+
 #endif /* lib/user/syscall.h */
@@ -0,0 +1,20 @@
+#ifndef __LIB_VM_USAGE_H
+#define __LIB_VM_USAGE_H
+
+#include <stdint.h>
+
+/* Virtual memory usage of a process, kept by the kernel in the
+   process's thread and returned by the vm_usage() system
+   call. */
+struct vm_usage
+  {
+    long long minor_faults;     /* Faults handled without I/O. */
+    long long major_faults;     /* Faults that read a page from disk. */
+    long long swap_ins;         /* Pages read back from swap. */
+    long long swap_outs;        /* Pages evicted to swap. */
+    uint32_t rss;               /* Pages resident now. */
+    uint32_t peak_rss;          /* Most pages resident at once. */
+    uint64_t fault_cycles;      /* CPU cycles spent handling faults. */
+  };
+
+#endif /* lib/vm-usage.h */
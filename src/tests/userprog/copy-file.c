@@ -0,0 +1,43 @@
+/* Copies part of a file to another with copy_file() and checks
+   the data and both files' positions, including a copy cut
+   short by end of file. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE 3000
+
+static char buf[SIZE];
+static char copy[SIZE];
+
+void
+test_main (void) 
+{
+  int in, out;
+  size_t i;
+
+  for (i = 0; i < sizeof buf; i++)
+    buf[i] = i % 251;
+
+  CHECK (create ("data", SIZE), "create \"data\"");
+  CHECK ((in = open ("data")) > 1, "open \"data\"");
+  CHECK (write (in, buf, SIZE) == SIZE, "write \"data\"");
+  CHECK (create ("copy", SIZE), "create \"copy\"");
+  CHECK ((out = open ("copy")) > 1, "open \"copy\"");
+
+  CHECK (copy_file (in, out, 100, 2000) == 2000,
+         "copy 2000 bytes from offset 100");
+  CHECK (tell (in) == SIZE, "input position unchanged");
+  CHECK (tell (out) == 2000, "output position advanced");
+  CHECK (copy_file (in, out, 2500, 1000) == 500,
+         "copy stops at end of input");
+  CHECK (tell (out) == 2500, "output position advanced");
+
+  CHECK (pread (out, copy, 2500, 0) == 2500, "read back \"copy\"");
+  if (memcmp (copy, buf + 100, 2000) || memcmp (copy + 2000, buf + 2500, 500))
+    fail ("copy holds wrong data");
+
+  CHECK (copy_file (in, 1234, 0, 1) == -1, "copy to bad handle fails");
+}
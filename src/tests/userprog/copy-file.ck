@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(copy-file) begin
+(copy-file) create "data"
+(copy-file) open "data"
+(copy-file) write "data"
+(copy-file) create "copy"
+(copy-file) open "copy"
+(copy-file) copy 2000 bytes from offset 100
+(copy-file) input position unchanged
+(copy-file) output position advanced
+(copy-file) copy stops at end of input
+(copy-file) output position advanced
+(copy-file) read back "copy"
+(copy-file) copy to bad handle fails
+(copy-file) end
+copy-file: exit(0)
+EOF
+pass;
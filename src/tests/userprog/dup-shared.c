@@ -0,0 +1,32 @@
+/* Duplicates a file descriptor with dup() and dup2() and checks
+   that the duplicates share a file position and outlive the
+   original. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  char buf[10];
+  int handle, copy;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK ((copy = dup (handle)) > 1, "dup");
+  if (copy == handle)
+    fail ("dup() returned the original handle %d", handle);
+
+  CHECK (read (handle, buf, sizeof buf) == sizeof buf, "read original");
+  CHECK (tell (copy) == sizeof buf, "copy shares position");
+
+  close (handle);
+  CHECK (read (copy, buf, sizeof buf) == sizeof buf,
+         "read copy after closing original");
+
+  CHECK (dup2 (copy, handle) == handle, "dup2 onto closed handle");
+  CHECK (tell (handle) == 2 * sizeof buf, "dup2 copy shares position");
+  CHECK (dup2 (copy, copy) == copy, "dup2 onto itself");
+  CHECK (dup (STDOUT_FILENO) == -1, "dup console fails");
+}
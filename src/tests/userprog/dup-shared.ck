@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(dup-shared) begin
+(dup-shared) open "sample.txt"
+(dup-shared) dup
+(dup-shared) read original
+(dup-shared) copy shares position
+(dup-shared) read copy after closing original
+(dup-shared) dup2 onto closed handle
+(dup-shared) dup2 copy shares position
+(dup-shared) dup2 onto itself
+(dup-shared) dup console fails
+(dup-shared) end
+dup-shared: exit(0)
+EOF
+pass;
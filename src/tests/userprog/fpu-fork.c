@@ -0,0 +1,72 @@
+/* Puts the FPU in a nonstandard state and forks.  Verifies that
+   the child inherits the state, then has parent and child both
+   compute with the FPU, with different control words, for long
+   enough that the scheduler switches between them many times.
+   Each verifies that its own registers and control word
+   survived the switches. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* Number of terms each process sums. */
+#define TERMS 2000000
+
+/* x87 control words: all exceptions masked, extended precision,
+   and rounding down for the parent, up for the child. */
+#define PARENT_CW 0x077f
+#define CHILD_CW 0x0b7f
+
+/* Returns the x87 control word. */
+static unsigned short
+get_cw (void)
+{
+  unsigned short cw;
+  asm volatile ("fnstcw %0" : "=m" (cw));
+  return cw;
+}
+
+/* Sets the x87 control word to CW. */
+static void
+set_cw (unsigned short cw)
+{
+  asm volatile ("fldcw %0" : : "m" (cw));
+}
+
+/* Returns true if summing STEP, 2 * STEP, ..., TERMS * STEP on
+   the FPU gives the right answer and leaves the control word
+   equal to CW.  The partial sums stay in an FPU register
+   throughout, and are integers small enough to be exact. */
+static bool
+sum_ok (int step, unsigned short cw)
+{
+  volatile double total;
+  double sum = 0.0;
+  int i;
+
+  for (i = 1; i <= TERMS; i++)
+    sum += i * step;
+  total = sum;
+  return total == (double) TERMS * (TERMS + 1) / 2 * step
+         && get_cw () == cw;
+}
+
+void
+test_main (void)
+{
+  pid_t child;
+
+  set_cw (PARENT_CW);
+
+  child = fork ();
+  if (child == 0)
+    {
+      if (get_cw () != PARENT_CW)
+        exit (-1);
+      set_cw (CHILD_CW);
+      exit (sum_ok (3, CHILD_CW) ? 0x42 : -1);
+    }
+  CHECK (child != PID_ERROR, "fork");
+  CHECK (sum_ok (5, PARENT_CW), "parent's FPU state intact");
+  CHECK (wait (child) == 0x42, "child's FPU state intact");
+}
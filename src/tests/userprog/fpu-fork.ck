@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(fpu-fork) begin
+(fpu-fork) fork
+(fpu-fork) parent's FPU state intact
+(fpu-fork) child's FPU state intact
+(fpu-fork) end
+EOF
+pass;
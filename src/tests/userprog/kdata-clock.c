@@ -0,0 +1,50 @@
+/* Reads the time and pid from the kernel data page: checks that
+   the tick count advances, that a forked child sees its own pid,
+   and that the page cannot be written. */
+
+#include <kdata.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  pid_t parent = getpid ();
+  pid_t child, child_pid;
+  int64_t start;
+  int handle;
+
+  CHECK (clock_freq () >= 19 && clock_freq () <= 1000,
+         "clock_freq() is a valid timer frequency");
+  start = clock_ticks ();
+  while (clock_ticks () == start)
+    continue;
+  msg ("clock_ticks() advanced");
+
+  CHECK (create ("pid", sizeof child_pid), "create \"pid\"");
+  child = fork ();
+  if (child == 0)
+    {
+      child_pid = getpid ();
+      handle = open ("pid");
+      write (handle, &child_pid, sizeof child_pid);
+      exit (child_pid != parent ? 81 : 1);
+    }
+  CHECK (wait (child) == 81, "child's pid differs from parent's");
+  CHECK ((handle = open ("pid")) > 1, "open \"pid\"");
+  CHECK (read (handle, &child_pid, sizeof child_pid) == sizeof child_pid,
+         "read \"pid\"");
+  if (child_pid != child)
+    fail ("child's getpid() returned %d, but fork() returned %d",
+          child_pid, child);
+  CHECK (getpid () == parent, "parent's pid unchanged");
+
+  child = fork ();
+  if (child == 0)
+    {
+      KDATA_ADDR->timer_freq = 0;
+      exit (0);
+    }
+  CHECK (wait (child) == -1, "writing the page kills the process");
+}
@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_USER_FAULTS => 1, [<<'EOF']);
+(kdata-clock) begin
+(kdata-clock) clock_freq() is a valid timer frequency
+(kdata-clock) clock_ticks() advanced
+(kdata-clock) create "pid"
+kdata-clock: exit(81)
+(kdata-clock) child's pid differs from parent's
+(kdata-clock) open "pid"
+(kdata-clock) read "pid"
+(kdata-clock) parent's pid unchanged
+kdata-clock: exit(-1)
+(kdata-clock) writing the page kills the process
+(kdata-clock) end
+kdata-clock: exit(0)
+EOF
+pass;
@@ -0,0 +1,126 @@
+/* Exercises malloc(), calloc(), realloc() and free(): checks
+   that blocks of many sizes hold their contents, that freeing a
+   large block gives memory back to the system, that free blocks
+   next to each other are merged, that realloc() keeps a block's
+   contents, and that calloc() zeroes memory reused from freed
+   blocks. */
+
+#include <random.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* Number of small blocks. */
+#define SMALL_CNT 500
+
+/* Number and size of blocks to merge. */
+#define MERGE_CNT 8
+#define MERGE_SIZE (16 * 1024)
+
+static void *blocks[SMALL_CNT];
+static size_t sizes[SMALL_CNT];
+
+/* Allocates block I of a random size between 1 and 1100 bytes
+   and fills it with I. */
+static void
+alloc_block (int i)
+{
+  sizes[i] = random_ulong () % 1100 + 1;
+  blocks[i] = malloc (sizes[i]);
+  if (blocks[i] == NULL)
+    fail ("malloc (%zu) failed", sizes[i]);
+  memset (blocks[i], i, sizes[i]);
+}
+
+/* Checks that block I is still filled with I, then frees it. */
+static void
+free_block (int i)
+{
+  const uint8_t *p = blocks[i];
+  size_t j;
+
+  for (j = 0; j < sizes[i]; j++)
+    if (p[j] != (uint8_t) i)
+      fail ("block %d, of %zu bytes, corrupted at byte %zu",
+            i, sizes[i], j);
+  free (blocks[i]);
+}
+
+void
+test_main (void) 
+{
+  uint8_t *before, *p, *q;
+  size_t i, size;
+
+  /* Free a large block at the end of the heap. */
+  before = sbrk (0);
+  CHECK ((p = malloc (300 * 1024)) != NULL, "malloc 300 kB");
+  CHECK ((uint8_t *) sbrk (0) > before, "heap grew");
+  free (p);
+  CHECK ((uint8_t *) sbrk (0) < before + 300 * 1024,
+         "free returned memory to the system");
+
+  /* Many small blocks, freed in two interleaved passes. */
+  random_init (0);
+  for (i = 0; i < SMALL_CNT; i++)
+    alloc_block (i);
+  for (i = 0; i < SMALL_CNT; i += 2)
+    free_block (i);
+  for (i = 0; i < SMALL_CNT; i += 2)
+    alloc_block (i);
+  for (i = 0; i < SMALL_CNT; i++)
+    free_block (i);
+  msg ("small blocks kept their contents");
+
+  /* Adjacent large blocks, freed in an order that merges each
+     with the block before it, after it, or both. */
+  for (i = 0; i < MERGE_CNT; i++)
+    {
+      blocks[i] = malloc (MERGE_SIZE);
+      if (blocks[i] == NULL)
+        fail ("malloc %d kB failed", MERGE_SIZE / 1024);
+    }
+  before = sbrk (0);
+  for (i = 0; i < MERGE_CNT; i += 2)
+    free (blocks[i]);
+  for (i = 1; i < MERGE_CNT; i += 2)
+    free (blocks[i]);
+  CHECK ((p = malloc (MERGE_CNT * MERGE_SIZE)) != NULL,
+         "malloc %d kB", MERGE_CNT * MERGE_SIZE / 1024);
+  CHECK (sbrk (0) == before, "freed blocks were merged");
+  free (p);
+
+  /* Grow a block from 10 bytes to 100 kB and back. */
+  p = malloc (10);
+  memset (p, 0xa5, 10);
+  for (size = 10; size < 100 * 1024; size *= 2)
+    {
+      q = realloc (p, size * 2);
+      if (q == NULL)
+        fail ("realloc to %zu bytes failed", size * 2);
+      for (i = 0; i < size; i++)
+        if (q[i] != 0xa5)
+          fail ("realloc to %zu bytes lost byte %zu", size * 2, i);
+      memset (q, 0xa5, size * 2);
+      p = q;
+    }
+  p = realloc (p, 10);
+  for (i = 0; i < 10; i++)
+    if (p[i] != 0xa5)
+      fail ("shrinking realloc lost byte %zu", i);
+  free (p);
+  msg ("realloc kept block contents");
+
+  /* Memory just freed is dirty, but calloc() zeroes it. */
+  p = malloc (5000);
+  memset (p, 0xff, 5000);
+  free (p);
+  CHECK ((p = calloc (1000, 5)) != NULL, "calloc 5000 bytes");
+  for (i = 0; i < 5000; i++)
+    if (p[i] != 0)
+      fail ("calloc'd byte %zu is %d", i, p[i]);
+  free (p);
+  msg ("calloc zeroed the block");
+}
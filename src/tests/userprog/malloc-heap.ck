@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(malloc-heap) begin
+(malloc-heap) malloc 300 kB
+(malloc-heap) heap grew
+(malloc-heap) free returned memory to the system
+(malloc-heap) small blocks kept their contents
+(malloc-heap) malloc 128 kB
+(malloc-heap) freed blocks were merged
+(malloc-heap) realloc kept block contents
+(malloc-heap) calloc 5000 bytes
+(malloc-heap) calloc zeroed the block
+(malloc-heap) end
+malloc-heap: exit(0)
+EOF
+pass;
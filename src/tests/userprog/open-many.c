@@ -0,0 +1,29 @@
+/* Opens the same file hundreds of times, checking that each
+   open() returns the lowest free file descriptor, including one
+   freed in the middle of the range. */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* Number of times to open the file. */
+#define OPEN_CNT 300
+
+void
+test_main (void) 
+{
+  int i;
+
+  for (i = 0; i < OPEN_CNT; i++)
+    {
+      int handle = open ("sample.txt");
+      if (handle != i + 2)
+        fail ("open #%d returned %d, expected %d", i, handle, i + 2);
+    }
+  msg ("opened \"sample.txt\" %d times", OPEN_CNT);
+
+  close (OPEN_CNT / 2);
+  CHECK (open ("sample.txt") == OPEN_CNT / 2, "reopen lowest free handle");
+  check_file_handle (OPEN_CNT + 1, "sample.txt", sample, sizeof sample - 1);
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(open-many) begin
+(open-many) opened "sample.txt" 300 times
+(open-many) reopen lowest free handle
+(open-many) verified contents of "sample.txt"
+(open-many) end
+open-many: exit(0)
+EOF
+pass;
@@ -0,0 +1,39 @@
+/* Writes a file with writev() and pwrite() and reads it back
+   with pread() and readv(), checking that the vectored calls
+   move the file position and the positional calls do not. */
+
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  char a[] = "abc", b[] = "defgh", c[] = "ij";
+  struct iovec out[3] = {{a, 3}, {b, 5}, {c, 2}};
+  char x[4], y[6], buf[5];
+  struct iovec in[2] = {{x, sizeof x}, {y, sizeof y}};
+  int handle;
+
+  CHECK (create ("data", 64), "create \"data\"");
+  CHECK ((handle = open ("data")) > 1, "open \"data\"");
+
+  CHECK (writev (handle, out, 3) == 10, "writev 3 buffers");
+  CHECK (tell (handle) == 10, "writev moved position");
+
+  CHECK (pread (handle, buf, 5, 3) == 5, "pread 5 bytes at offset 3");
+  if (memcmp (buf, "defgh", 5))
+    fail ("pread read wrong data");
+  CHECK (pwrite (handle, "XY", 2, 0) == 2, "pwrite 2 bytes at offset 0");
+  CHECK (tell (handle) == 10, "pread and pwrite left position alone");
+
+  seek (handle, 0);
+  CHECK (readv (handle, in, 2) == 10, "readv 2 buffers");
+  if (memcmp (x, "XYcd", 4) || memcmp (y, "efghij", 6))
+    fail ("readv read wrong data");
+  CHECK (tell (handle) == 10, "readv moved position");
+
+  CHECK (pread (STDIN_FILENO, buf, 1, 0) == -1, "pread console fails");
+}
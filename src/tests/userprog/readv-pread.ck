@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(readv-pread) begin
+(readv-pread) create "data"
+(readv-pread) open "data"
+(readv-pread) writev 3 buffers
+(readv-pread) writev moved position
+(readv-pread) pread 5 bytes at offset 3
+(readv-pread) pwrite 2 bytes at offset 0
+(readv-pread) pread and pwrite left position alone
+(readv-pread) readv 2 buffers
+(readv-pread) readv moved position
+(readv-pread) pread console fails
+(readv-pread) end
+readv-pread: exit(0)
+EOF
+pass;
@@ -0,0 +1,87 @@
+/* Opens, reads, and closes "sample.txt" through submission and
+   completion rings, submitting several reads in one batch, and
+   checks that the process and the ring worker share the file
+   descriptor table. */
+
+#include <ring.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* Reads submitted in one batch. */
+#define READ_CNT 4
+
+/* Offset in the ring's buffer that reads go to. */
+#define DATA_OFS 512
+
+static struct ring_area *ring = (struct ring_area *) 0x10000000;
+
+/* Submits an entry with the given members. */
+static void
+submit (int op, int fd, int pos, unsigned buf, unsigned len,
+        unsigned user_data)
+{
+  struct ring_sqe sqe = {op, fd, pos, buf, len, user_data};
+  if (!ring_push (ring, &sqe))
+    fail ("submission queue full");
+}
+
+/* Reaps a completion and returns its result, checking that it
+   is for USER_DATA. */
+static int
+reap (unsigned user_data)
+{
+  struct ring_cqe cqe;
+  if (!ring_pop (ring, &cqe))
+    fail ("completion queue empty");
+  if (cqe.user_data != user_data)
+    fail ("completion for %u, expected %u", cqe.user_data, user_data);
+  return cqe.result;
+}
+
+void
+test_main (void) 
+{
+  size_t size = sizeof sample - 1;
+  size_t chunk = size / READ_CNT;
+  int handle;
+  int i;
+
+  CHECK (ring_setup (ring), "set up rings");
+  CHECK (!ring_setup (ring), "second set up fails");
+
+  strlcpy ((char *) ring->buf, "sample.txt", RING_BUF_SIZE);
+  submit (RING_OPEN, 0, 0, 0, strlen ("sample.txt"), 1);
+  CHECK (ring_enter (1) == 1, "submit open");
+  CHECK ((handle = reap (1)) > 1, "open \"sample.txt\"");
+
+  for (i = 0; i < READ_CNT; i++)
+    submit (RING_READ, handle, i * chunk, DATA_OFS + i * chunk,
+            i < READ_CNT - 1 ? chunk : size - i * chunk, 10 + i);
+  submit (RING_NOP, 0, 0, 0, 0, 20);
+  submit (RING_READ, 1234, 0, DATA_OFS, 1, 21);
+  submit (RING_WRITE, handle, 0, RING_BUF_SIZE, 1, 22);
+  CHECK (ring_enter (READ_CNT + 3) == READ_CNT + 3,
+         "submit %d reads and 3 other entries", READ_CNT);
+  for (i = 0; i < READ_CNT; i++)
+    if (reap (10 + i) != (int) (i < READ_CNT - 1 ? chunk : size - i * chunk))
+      fail ("read %d came up short", i);
+  CHECK (reap (20) == 0, "nop succeeds");
+  CHECK (reap (21) == -1, "read from bad handle fails");
+  CHECK (reap (22) == -1, "write outside ring buffer fails");
+  if (memcmp (ring->buf + DATA_OFS, sample, size))
+    fail ("reads returned wrong data");
+  CHECK (tell (handle) == 0, "positional reads left position alone");
+
+  submit (RING_READ, handle, -1, DATA_OFS, 10, 30);
+  ring_enter (1);
+  CHECK (reap (30) == 10 && tell (handle) == 10,
+         "read at position advances it");
+
+  submit (RING_CLOSE, handle, 0, 0, 0, 40);
+  ring_enter (1);
+  CHECK (reap (40) == 0, "close \"sample.txt\"");
+  CHECK ((int) tell (handle) == -1, "handle closed for process too");
+}
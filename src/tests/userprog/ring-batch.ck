@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(ring-batch) begin
+(ring-batch) set up rings
+(ring-batch) second set up fails
+(ring-batch) submit open
+(ring-batch) open "sample.txt"
+(ring-batch) submit 4 reads and 3 other entries
+(ring-batch) nop succeeds
+(ring-batch) read from bad handle fails
+(ring-batch) write outside ring buffer fails
+(ring-batch) positional reads left position alone
+(ring-batch) read at position advances it
+(ring-batch) close "sample.txt"
+(ring-batch) handle closed for process too
+(ring-batch) end
+ring-batch: exit(0)
+EOF
+pass;
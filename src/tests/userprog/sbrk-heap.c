@@ -0,0 +1,62 @@
+/* Grows and shrinks the heap with sbrk(): checks that new heap
+   memory reads as zeros, that a forked child gets a copy of the
+   heap, that the break cannot move below the start of the heap,
+   and that memory given back cannot be accessed. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* Bytes to grow the heap by: more than a page, not a whole
+   number of pages. */
+#define SIZE (3 * 4096 + 100)
+
+static bool
+is_zeroed (const uint8_t *p, size_t size)
+{
+  size_t i;
+
+  for (i = 0; i < size; i++)
+    if (p[i] != 0)
+      return false;
+  return true;
+}
+
+void
+test_main (void) 
+{
+  uint8_t *start = sbrk (0);
+  uint8_t *heap;
+  pid_t child;
+
+  CHECK ((heap = sbrk (SIZE)) == start, "grow heap");
+  CHECK (sbrk (0) == start + SIZE, "break moved");
+  CHECK (is_zeroed (heap, SIZE), "new heap memory is zeroed");
+  memset (heap, 0x5a, SIZE);
+
+  child = fork ();
+  if (child == 0)
+    {
+      if (heap[0] != 0x5a || heap[SIZE - 1] != 0x5a)
+        exit (1);
+      memset (heap, 0, SIZE);
+      exit (81);
+    }
+  CHECK (wait (child) == 81, "child sees parent's heap");
+  CHECK (heap[0] == 0x5a && heap[SIZE - 1] == 0x5a,
+         "child's writes don't affect parent's heap");
+
+  CHECK (sbrk (-SIZE - 1) == (void *) -1, "can't shrink past start");
+  CHECK (sbrk (-SIZE) == start + SIZE, "shrink heap");
+  CHECK (brk (start + 4096) == 0, "brk() to one page");
+  CHECK (is_zeroed (heap, 4096), "regrown heap memory is zeroed");
+
+  child = fork ();
+  if (child == 0)
+    {
+      heap[4096] = 1;
+      exit (0);
+    }
+  CHECK (wait (child) == -1, "accessing memory past the break kills");
+}
@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_USER_FAULTS => 1, [<<'EOF']);
+(sbrk-heap) begin
+(sbrk-heap) grow heap
+(sbrk-heap) break moved
+(sbrk-heap) new heap memory is zeroed
+sbrk-heap: exit(81)
+(sbrk-heap) child sees parent's heap
+(sbrk-heap) child's writes don't affect parent's heap
+(sbrk-heap) can't shrink past start
+(sbrk-heap) shrink heap
+(sbrk-heap) brk() to one page
+(sbrk-heap) regrown heap memory is zeroed
+sbrk-heap: exit(-1)
+(sbrk-heap) accessing memory past the break kills
+(sbrk-heap) end
+sbrk-heap: exit(0)
+EOF
+pass;
@@ -0,0 +1,61 @@
+/* Reads "sample.txt" a line at a time through a stream, then
+   writes a file through a fully buffered stream, checking that
+   output reaches the file only when the buffer is flushed. */
+
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char big[600];
+
+void
+test_main (void) 
+{
+  char text[sizeof sample];
+  char line[32];
+  size_t ofs = 0;
+  FILE *stream;
+  char c;
+  int handle;
+
+  CHECK (fopen ("no-such-file", "r") == NULL, "fopen missing file fails");
+  CHECK ((stream = fopen ("sample.txt", "r")) != NULL, "fopen \"sample.txt\"");
+  while (fgets (line, sizeof line, stream) != NULL)
+    {
+      size_t length = strlen (line);
+      if (ofs + length >= sizeof text)
+        fail ("read too much");
+      memcpy (text + ofs, line, length);
+      ofs += length;
+    }
+  text[ofs] = '\0';
+  if (strcmp (text, sample))
+    fail ("fgets read wrong data");
+  CHECK (feof (stream) && !ferror (stream), "fgets reached end of file");
+  CHECK (fputc ('x', stream) == EOF && ferror (stream),
+         "writing read-only stream fails");
+  CHECK (fclose (stream) == 0, "fclose \"sample.txt\"");
+
+  CHECK (create ("data", 1024), "create \"data\"");
+  CHECK ((stream = fopen ("data", "r+")) != NULL, "fopen \"data\"");
+  CHECK ((handle = open ("data")) > 1, "open \"data\"");
+  CHECK (fprintf (stream, "%s, %d", "hello", 42) == 9, "fprintf");
+  CHECK (read (handle, &c, 1) == 1 && c == '\0', "output still buffered");
+  CHECK (fflush (stream) == 0, "fflush");
+  CHECK (pread (handle, line, 9, 0) == 9 && !memcmp (line, "hello, 42", 9),
+         "output written by fflush");
+  memset (big, 'z', sizeof big);
+  CHECK (fwrite (big, 1, sizeof big, stream) == sizeof big,
+         "fwrite larger than buffer");
+  CHECK (pread (handle, line, 4, 605) == 4 && !memcmp (line, "zzzz", 4),
+         "large fwrite bypassed buffer");
+  CHECK (fclose (stream) == 0, "fclose \"data\"");
+
+  CHECK ((stream = fopen ("data", "r")) != NULL, "reopen \"data\"");
+  CHECK (fread (line, 1, 9, stream) == 9 && !memcmp (line, "hello, 42", 9),
+         "fread");
+  fclose (stream);
+}
@@ -0,0 +1,27 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(stdio-file) begin
+(stdio-file) fopen missing file fails
+(stdio-file) fopen "sample.txt"
+(stdio-file) fgets reached end of file
+(stdio-file) writing read-only stream fails
+(stdio-file) fclose "sample.txt"
+(stdio-file) create "data"
+(stdio-file) fopen "data"
+(stdio-file) open "data"
+(stdio-file) fprintf
+(stdio-file) output still buffered
+(stdio-file) fflush
+(stdio-file) output written by fflush
+(stdio-file) fwrite larger than buffer
+(stdio-file) large fwrite bypassed buffer
+(stdio-file) fclose "data"
+(stdio-file) reopen "data"
+(stdio-file) fread
+(stdio-file) end
+stdio-file: exit(0)
+EOF
+pass;
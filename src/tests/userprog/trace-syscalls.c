@@ -0,0 +1,19 @@
+/* Traces a few system calls with trace() and checks, in the
+   .ck file, that the trace printed when tracing stops records
+   them, and nothing after. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  int i;
+
+  CHECK (trace (true), "trace (true)");
+  for (i = 0; i < 3; i++)
+    tell (-1);
+  CHECK (trace (false), "trace (false)");
+  tell (-1);
+}
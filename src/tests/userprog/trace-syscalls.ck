@@ -0,0 +1,73 @@
+# -*- perl -*-
+
+# The expected output looks like this, where the numbers after
+# each `+' are cycle counts that vary from run to run:
+#
+# (trace-syscalls) begin
+# (trace-syscalls) trace (true)
+# trace: trace-syscalls: begin 5 records, 0 dropped
+# trace: trace-syscalls: +2f0 9(1,bfffff1c,1d) = 1d 1a4e
+# trace: trace-syscalls: +1c66 b(ffffffff) = ffffffff 3a2
+# trace: trace-syscalls: +3cc b(ffffffff) = ffffffff 38e
+# trace: trace-syscalls: +3b8 b(ffffffff) = ffffffff 38e
+# trace: trace-syscalls: +3b4 1f(0) = ? ?
+# trace: trace-syscalls: end
+# trace: trace-syscalls: syscall 9: 1 calls, 6734 cycles avg, 6734 max
+# trace: trace-syscalls: syscall 11: 3 calls, 916 cycles avg, 930 max
+# (trace-syscalls) trace (false)
+# (trace-syscalls) end
+# trace-syscalls: exit(0)
+
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+my ($SYS_WRITE, $SYS_TELL, $SYS_TRACE) = (9, 11, 31);
+
+my (@trace) = map (/^trace: trace-syscalls: (.*)$/ ? $1 : (), @output);
+fail "No trace found in output.\n" if !@trace;
+
+my ($begin) = shift (@trace);
+fail "Trace does not start with 5 records, 0 dropped: $begin\n"
+  if $begin ne 'begin 5 records, 0 dropped';
+
+my (@records);
+while (@trace && $trace[0] ne 'end') {
+    my ($line) = shift (@trace);
+    my ($nr, $args, $ret, $cycles)
+      = $line =~ /^\+[0-9a-f]+ ([0-9a-f]+)\(([0-9a-f,]*)\) = (\S+) (\S+)$/
+      or fail "Malformed trace record: $line\n";
+    push (@records, [hex ($nr), $args, $ret, $cycles]);
+}
+fail "Trace has no end.\n" if !@trace;
+shift (@trace);
+
+fail "First record is not write(): @{$records[0]}\n"
+  if $records[0][0] != $SYS_WRITE || $records[0][3] eq '?';
+for my $i (1...3) {
+    fail "Record $i is not tell(-1) = -1: @{$records[$i]}\n"
+      if ($records[$i][0] != $SYS_TELL || $records[$i][1] ne 'ffffffff'
+	  || $records[$i][2] ne 'ffffffff' || $records[$i][3] eq '?');
+}
+fail "Last record is not an unfinished trace(false): @{$records[4]}\n"
+  if ($records[4][0] != $SYS_TRACE || $records[4][1] ne '0'
+      || $records[4][2] ne '?');
+
+my (@summary) = map (/^syscall (\d+): (\d+) calls, \d+ cycles avg, \d+ max$/
+		     ? "$1:$2" : "bad: $_", @trace);
+@summary = sort @summary;
+fail "Summary should count 1 write() and 3 tell()s: @summary\n"
+  if "@summary" ne "$SYS_TELL:3 $SYS_WRITE:1";
+
+my (@messages) = grep (/^\(trace-syscalls\)/, @output);
+fail "Unexpected messages: @messages\n"
+  if "@messages" ne join (' ', map ("(trace-syscalls) $_",
+				     'begin', 'trace (true)',
+				     'trace (false)', 'end'));
+
+pass;
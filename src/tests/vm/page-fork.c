@@ -0,0 +1,46 @@
+/* Fills 64 kB of memory, forks, and has the child overwrite the
+   first half of it.  Verifies that the child sees its own
+   writes and the parent's untouched second half, and that the
+   parent's memory is unaffected by the child's writes. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (64 * 1024)
+
+static char buf[SIZE];
+
+/* Returns true if the LENGTH bytes at P all equal C. */
+static bool
+all_equal (const char *p, size_t length, char c)
+{
+  size_t i;
+
+  for (i = 0; i < length; i++)
+    if (p[i] != c)
+      return false;
+  return true;
+}
+
+void
+test_main (void)
+{
+  pid_t child;
+
+  memset (buf, 'p', SIZE);
+
+  child = fork ();
+  if (child == 0)
+    {
+      memset (buf, 'c', SIZE / 2);
+      if (!all_equal (buf, SIZE / 2, 'c')
+          || !all_equal (buf + SIZE / 2, SIZE / 2, 'p'))
+        exit (-1);
+      exit (0x42);
+    }
+  CHECK (child != PID_ERROR, "fork");
+  CHECK (wait (child) == 0x42, "wait for child");
+  CHECK (all_equal (buf, SIZE, 'p'), "parent's memory unchanged");
+}
@@ -0,0 +1,50 @@
+/* Touches a few scattered pages of two large initialized
+   arrays, one read-only and one writable, and verifies that
+   each holds its initial contents.  A kernel with demand paging
+   reads each of these pages from the executable only when it is
+   first touched. */
+
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* Each array spans PAGE_CNT pages.  Page N of an array has
+   value N at index N within the page, if it is initialized. */
+#define PAGE_INTS (4096 / sizeof (int))
+#define PAGE_CNT 64
+#define INIT(N) [(N) * PAGE_INTS + (N)] = (N)
+
+static const int ro[PAGE_CNT * PAGE_INTS] =
+  {INIT (1), INIT (17), INIT (42), INIT (63)};
+static int rw[PAGE_CNT * PAGE_INTS] = {INIT (2), INIT (31), INIT (63)};
+
+/* Fails unless the marked element of page PAGE of ARRAY, called
+   NAME, holds VALUE. */
+static void
+check (const char *name, const int *array, int page, int value)
+{
+  int actual = array[page * PAGE_INTS + page];
+  if (actual != value)
+    fail ("%s page %d holds %d instead of %d", name, page, actual, value);
+}
+
+void
+test_main (void)
+{
+  msg ("read-only pages");
+  check ("ro", ro, 63, 63);
+  check ("ro", ro, 1, 1);
+  check ("ro", ro, 42, 42);
+  check ("ro", ro, 30, 0);
+  check ("ro", ro, 17, 17);
+
+  msg ("writable pages");
+  check ("rw", rw, 31, 31);
+  check ("rw", rw, 10, 0);
+  check ("rw", rw, 63, 63);
+  check ("rw", rw, 2, 2);
+
+  msg ("modify writable page");
+  rw[10 * PAGE_INTS + 10] = 10;
+  check ("rw", rw, 10, 10);
+  check ("rw", rw, 31, 31);
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-lazy) begin
+(page-lazy) read-only pages
+(page-lazy) writable pages
+(page-lazy) modify writable page
+(page-lazy) end
+EOF
+pass;
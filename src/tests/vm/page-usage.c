@@ -0,0 +1,40 @@
+/* Writes to 32 untouched pages of an uninitialized array and
+   verifies that vm_usage() counts at least one fault for each
+   and that the resident set grew by at least that much, without
+   exceeding its peak. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define PAGE_CNT 32
+
+static char pages[PAGE_CNT * PAGE_SIZE];
+
+void
+test_main (void)
+{
+  struct vm_usage before, after;
+  long long faults;
+  int i;
+
+  vm_usage (&before);
+  for (i = 0; i < PAGE_CNT; i++)
+    pages[i * PAGE_SIZE] = i;
+  vm_usage (&after);
+
+  faults = ((after.minor_faults + after.major_faults)
+            - (before.minor_faults + before.major_faults));
+  if (faults < PAGE_CNT)
+    fail ("%lld faults counted for %d new pages", faults, PAGE_CNT);
+  msg ("faults counted");
+
+  if (after.rss < before.rss + PAGE_CNT)
+    fail ("resident set grew from %u to %u pages",
+          (unsigned) before.rss, (unsigned) after.rss);
+  if (after.peak_rss < after.rss)
+    fail ("peak of %u pages is below current %u pages",
+          (unsigned) after.peak_rss, (unsigned) after.rss);
+  msg ("resident set grew");
+}
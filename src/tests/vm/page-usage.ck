@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-usage) begin
+(page-usage) faults counted
+(page-usage) resident set grew
+(page-usage) end
+EOF
+pass;
@@ -0,0 +1,47 @@
+/* Reads every page of a large uninitialized array, then writes
+   to a few of them and verifies that the writes show up only in
+   the pages written.  A kernel with a shared zero page maps all
+   of the array's pages to the same frame until they are
+   written, so a write that reached that frame would show up
+   everywhere. */
+
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define PAGE_CNT 256
+
+static char zeros[PAGE_CNT * PAGE_SIZE];
+
+/* Fails unless every byte of page PAGE of the array is zero,
+   apart from the first byte, which must be FIRST. */
+static void
+check_page (int page, char first)
+{
+  const char *p = zeros + page * PAGE_SIZE;
+  int i;
+
+  if (p[0] != first)
+    fail ("page %d begins with %d instead of %d", page, p[0], first);
+  for (i = 1; i < PAGE_SIZE; i++)
+    if (p[i] != 0)
+      fail ("byte %d of page %d is %d", i, page, p[i]);
+}
+
+void
+test_main (void)
+{
+  int page;
+
+  msg ("read all pages");
+  for (page = 0; page < PAGE_CNT; page++)
+    check_page (page, 0);
+
+  msg ("write some pages");
+  for (page = 0; page < PAGE_CNT; page += 37)
+    zeros[page * PAGE_SIZE] = page % 100 + 1;
+
+  msg ("read all pages again");
+  for (page = 0; page < PAGE_CNT; page++)
+    check_page (page, page % 37 == 0 ? page % 100 + 1 : 0);
+}
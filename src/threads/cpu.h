@@ -0,0 +1,111 @@
+#ifndef THREADS_CPU_H
+#define THREADS_CPU_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Helpers for querying and configuring x86 processor features.
+
+   See [IA32-v2a] "CPUID" for the feature flags and [IA32-v3a]
+   2.5 "Control Registers" for the control register bits. */
+
+/* Control register 0 flags. */
+#define CR0_MP 0x00000002       /* Monitor Coprocessor (WAIT obeys TS). */
+#define CR0_EM 0x00000004       /* (Floating-point) Emulation. */
+#define CR0_TS 0x00000008       /* Task Switched (FPU state not loaded). */
+#define CR0_NE 0x00000020       /* Numeric Error (#MF for FPU errors). */
+
+/* Control register 4 flags. */
+#define CR4_PSE 0x00000010      /* Page Size Extensions (4 MB pages). */
+#define CR4_PGE 0x00000080      /* Page Global Enable. */
+#define CR4_OSFXSR 0x00000200   /* FXSAVE/FXRSTOR and SSE enabled. */
+#define CR4_OSXMMEXCPT 0x00000400 /* #XF for SSE errors. */
+
+/* Feature flags reported in EDX by CPUID function 1. */
+#define CPUID_PSE 0x00000008    /* 4 MB pages supported. */
+#define CPUID_SEP 0x00000800    /* SYSENTER and SYSEXIT supported. */
+#define CPUID_PGE 0x00002000    /* Global pages supported. */
+#define CPUID_FXSR 0x01000000   /* FXSAVE and FXRSTOR supported. */
+#define CPUID_SSE 0x02000000    /* SSE supported. */
+
+/* Model-specific registers that configure SYSENTER.
+   See [IA32-v2b] "SYSENTER". */
+#define MSR_SYSENTER_CS  0x174  /* Kernel code segment. */
+#define MSR_SYSENTER_ESP 0x175  /* Kernel stack pointer. */
+#define MSR_SYSENTER_EIP 0x176  /* Kernel entry point. */
+
+/* Returns the feature flags that CPUID function 1 reports in
+   EDX. */
+static inline uint32_t
+cpu_features (void)
+{
+  uint32_t eax = 1, ebx, ecx, edx;
+  asm volatile ("cpuid"
+                : "+a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx));
+  return edx;
+}
+
+/* Returns true if CPUID reports every feature in FEATURES. */
+static inline bool
+cpu_has (uint32_t features)
+{
+  return (cpu_features () & features) == features;
+}
+
+/* Returns the processor's time-stamp counter, which counts clock
+   cycles since reset. */
+static inline uint64_t
+rdtsc (void)
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
+/* Returns the contents of control register 0. */
+static inline uint32_t
+cr0_read (void)
+{
+  uint32_t cr0;
+  asm volatile ("movl %%cr0, %0" : "=r" (cr0));
+  return cr0;
+}
+
+/* Stores CR0 into control register 0. */
+static inline void
+cr0_write (uint32_t cr0)
+{
+  asm volatile ("movl %0, %%cr0" : : "r" (cr0) : "memory");
+}
+
+/* Clears the TS flag in control register 0. */
+static inline void
+clts (void)
+{
+  asm volatile ("clts");
+}
+
+/* Returns the contents of control register 4. */
+static inline uint32_t
+cr4_read (void)
+{
+  uint32_t cr4;
+  asm volatile ("movl %%cr4, %0" : "=r" (cr4));
+  return cr4;
+}
+
+/* Stores CR4 into control register 4. */
+static inline void
+cr4_write (uint32_t cr4)
+{
+  asm volatile ("movl %0, %%cr4" : : "r" (cr4) : "memory");
+}
+
+/* Stores VALUE into model-specific register MSR. */
+static inline void
+wrmsr (uint32_t msr, uint64_t value)
+{
+  asm volatile ("wrmsr" : : "c" (msr), "A" (value));
+}
+
+#endif /* threads/cpu.h */
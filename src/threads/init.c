@@ -15,6 +15,7 @@
 #include "devices/timer.h"
 #include "devices/vga.h"
 #include "devices/rtc.h"
+#include "threads/cpu.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
 #include "threads/loader.h"
@@ -25,8 +26,10 @@
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "userprog/exception.h"
+#include "userprog/fpu.h"
 #include "userprog/gdt.h"
 #include "userprog/syscall.h"
+#include "userprog/trace.h"
 #include "userprog/tss.h"
 #else
 #include "tests/threads/tests.h"
@@ -37,6 +40,11 @@
 #include "filesys/filesys.h"
 #include "filesys/fsutil.h"
 #endif
+#ifdef VM
+#include "vm/frame.h"
+#include "vm/page.h"
+#include "vm/swap.h"
+#endif
 
 /* Page directory with kernel mappings only. */
 uint32_t *init_page_dir;
@@ -57,6 +65,25 @@ static const char *swap_bdev_name;
 /* -ul: Maximum number of pages to put into palloc's user pool. */
 static size_t user_page_limit = SIZE_MAX;
 
+#ifdef VM
+/* -swapcache: Maximum number of pages of compressed data to keep
+   in the swap cache. */
+static size_t swap_cache_pages;
+
+/* -lowat, -hiwat: Free user page counts at which the page-out
+   daemon starts and stops evicting pages.  The daemon does not
+   run unless -lowat is given. */
+static size_t pageout_low;
+static size_t pageout_high;
+
+/* -dedup: Timer ticks between page deduplication passes, or 0
+   to disable deduplication. */
+static int64_t dedup_interval;
+#endif
+
+/* -nopse: Map kernel memory with 4 kB, non-global pages only? */
+static bool small_kernel_pages;
+
 static void bss_init (void);
 static void paging_init (void);
 
@@ -98,6 +125,9 @@ main (void)
   palloc_init (user_page_limit);
   malloc_init ();
   paging_init ();
+#ifdef VM
+  frame_init ();
+#endif
 
   /* Segmentation. */
 #ifdef USERPROG
@@ -113,6 +143,8 @@ main (void)
 #ifdef USERPROG
   exception_init ();
   syscall_init ();
+  fpu_init ();
+  process_init ();
 #endif
 
   /* Start thread scheduler and enable interrupts. */
@@ -127,6 +159,13 @@ main (void)
   filesys_init (format_filesys);
 #endif
 
+#ifdef VM
+  /* Initialize swap space. */
+  swap_init (swap_cache_pages);
+  frame_start_pageout (pageout_low, pageout_high);
+  frame_start_dedup (dedup_interval);
+#endif
+
   printf ("Boot complete.\n");
   
   /* Run actions specified on kernel command line. */
@@ -153,13 +192,29 @@ bss_init (void)
 /* Populates the base page directory and page table with the
    kernel virtual mapping, and then sets up the CPU to use the
    new page directory.  Points init_page_dir to the page
-   directory it creates. */
+   directory it creates.
+
+   When the CPU supports them, 4 MB regions of RAM are mapped
+   with single large-page PDEs instead of page tables, and all
+   kernel mappings are marked global so that they survive the
+   CR3 reload on every process switch (see pagedir_activate()).
+   The 4 MB region that holds the kernel's text is still mapped
+   with 4 kB pages, so that the text can stay read-only. */
 static void
 paging_init (void)
 {
   uint32_t *pd, *pt;
   size_t page;
   extern char _start, _end_kernel_text;
+  uint32_t features = small_kernel_pages ? 0 : cpu_features ();
+  bool large_pages = (features & CPUID_PSE) != 0;
+  uint32_t global = (features & CPUID_PGE) != 0 ? PTE_G : 0;
+  const size_t large_page_cnt = PTSPAN / PGSIZE;
+
+  /* The CPU must understand PTE_PS before we load a page
+     directory that uses it. */
+  if (large_pages)
+    cr4_write (cr4_read () | CR4_PSE);
 
   pd = init_page_dir = palloc_get_page (PAL_ASSERT | PAL_ZERO);
   pt = NULL;
@@ -171,13 +226,22 @@ paging_init (void)
       size_t pte_idx = pt_no (vaddr);
       bool in_kernel_text = &_start <= vaddr && vaddr < &_end_kernel_text;
 
+      if (large_pages && pte_idx == 0
+          && page + large_page_cnt <= init_ram_pages
+          && (vaddr + PTSPAN <= &_start || vaddr >= &_end_kernel_text))
+        {
+          pd[pde_idx] = pde_create_large (vaddr, true) | global;
+          page += large_page_cnt - 1;
+          continue;
+        }
+
       if (pd[pde_idx] == 0)
         {
           pt = palloc_get_page (PAL_ASSERT | PAL_ZERO);
           pd[pde_idx] = pde_create (pt);
         }
 
-      pt[pte_idx] = pte_create_kernel (vaddr, !in_kernel_text);
+      pt[pte_idx] = pte_create_kernel (vaddr, !in_kernel_text) | global;
     }
 
   /* Store the physical address of the page directory into CR3
@@ -186,6 +250,13 @@ paging_init (void)
      to/from Control Registers" and [IA32-v3a] 3.7.5 "Base Address
      of the Page Directory". */
   asm volatile ("movl %0, %%cr3" : : "r" (vtop (init_page_dir)));
+
+  /* Honor PTE_G from now on.  Setting CR4.PGE flushes the whole
+     TLB, including any stale entries left over from the
+     loader's page tables.  See [IA32-v3a] 3.12 "Translation
+     Lookaside Buffers (TLBs)". */
+  if (global)
+    cr4_write (cr4_read () | CR4_PGE);
 }
 
 /* Breaks the kernel command line into words and returns them as
@@ -256,9 +327,27 @@ parse_options (char **argv)
         random_init (atoi (value));
       else if (!strcmp (name, "-mlfqs"))
         thread_mlfqs = true;
+      else if (!strcmp (name, "-nopse"))
+        small_kernel_pages = true;
 #ifdef USERPROG
       else if (!strcmp (name, "-ul"))
         user_page_limit = atoi (value);
+      else if (!strcmp (name, "-strace"))
+        trace_all = true;
+#endif
+#ifdef VM
+      else if (!strcmp (name, "-swapcache"))
+        swap_cache_pages = atoi (value);
+      else if (!strcmp (name, "-lowat"))
+        pageout_low = atoi (value);
+      else if (!strcmp (name, "-hiwat"))
+        pageout_high = atoi (value);
+      else if (!strcmp (name, "-dedup"))
+        dedup_interval = atoi (value);
+      else if (!strcmp (name, "-faultaround"))
+        page_fault_around = atoi (value);
+      else if (!strcmp (name, "-vmstat"))
+        process_vm_report = true;
 #endif
       else
         PANIC ("unknown option `%s' (use -h for help)", name);
@@ -379,8 +468,18 @@ usage (void)
 #endif
           "  -rs=SEED           Set random number seed to SEED.\n"
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+          "  -nopse             Map kernel memory with 4 kB, non-global pages.\n"
 #ifdef USERPROG
           "  -ul=COUNT          Limit user memory to COUNT pages.\n"
+          "  -strace            Trace every process's system calls.\n"
+#endif
+#ifdef VM
+          "  -swapcache=COUNT   Keep up to COUNT pages of compressed swap in RAM.\n"
+          "  -lowat=COUNT       Start paging out below COUNT free user pages.\n"
+          "  -hiwat=COUNT       Stop paging out at COUNT free user pages.\n"
+          "  -dedup=TICKS       Merge identical user pages every TICKS ticks.\n"
+          "  -faultaround=COUNT Map up to COUNT nearby file pages per fault.\n"
+          "  -vmstat            Print memory usage of each process at exit.\n"
 #endif
           );
   shutdown_power_off ();
@@ -1,6 +1,7 @@
 #ifndef THREADS_PTE_H
 #define THREADS_PTE_H
 
+#include <stddef.h>
 #include "threads/vaddr.h"
 
 /* Functions and macros for working with x86 hardware page
@@ -66,6 +67,10 @@ static inline uintptr_t pd_no (const void *va) {
 #define PTE_U 0x4               /* 1=user/kernel, 0=kernel only. */
 #define PTE_A 0x20              /* 1=accessed, 0=not acccessed. */
 #define PTE_D 0x40              /* 1=dirty, 0=not dirty (PTEs only). */
+#define PTE_PS 0x80             /* 1=4 MB page, 0=page table (PDEs only). */
+#define PTE_G 0x100             /* 1=global, kept in TLB across CR3 loads. */
+#define PTE_SWAP 0x200          /* Not present, page is in swap (OS use). */
+#define PTE_COW 0x400           /* Read-only, copy on write (OS use). */
 
 /* Returns a PDE that points to page table PT. */
 static inline uint32_t pde_create (uint32_t *pt) {
@@ -77,9 +82,22 @@ static inline uint32_t pde_create (uint32_t *pt) {
    PDE, which must "present", points to. */
 static inline uint32_t *pde_get_pt (uint32_t pde) {
   ASSERT (pde & PTE_P);
+  ASSERT (!(pde & PTE_PS));
   return ptov (pde & PTE_ADDR);
 }
 
+/* Returns a PDE that maps the 4 MB region starting at PAGE
+   directly, without an intervening page table.  PAGE must be
+   aligned on a 4 MB boundary, and CR4.PSE must be set for the
+   CPU to honor the entry.
+   The region is readable.
+   If WRITABLE is true then it will be writable as well.
+   The region will be usable only by ring 0 code (the kernel). */
+static inline uint32_t pde_create_large (void *page, bool writable) {
+  ASSERT (((uintptr_t) page & (PTSPAN - 1)) == 0);
+  return vtop (page) | PTE_PS | PTE_P | (writable ? PTE_W : 0);
+}
+
 /* Returns a PTE that points to PAGE.
    The PTE's page is readable.
    If WRITABLE is true then it will be writable as well.
@@ -103,5 +121,22 @@ static inline void *pte_get_page (uint32_t pte) {
   return ptov (pte & PTE_ADDR);
 }
 
+/* Returns a PTE that is not present and instead records that the
+   page's contents are in swap slot SLOT.  The CPU ignores all
+   the other bits of a not-present PTE, so the slot number takes
+   the place of the physical address and PTE_W remembers whether
+   the page should be writable once it is brought back in. */
+static inline uint32_t pte_create_swap (size_t slot, bool writable) {
+  ASSERT (slot <= PTE_ADDR >> PTSHIFT);
+  return (slot << PTSHIFT) | PTE_SWAP | (writable ? PTE_W : 0);
+}
+
+/* Returns the swap slot recorded in PTE, which must have been
+   created by pte_create_swap(). */
+static inline size_t pte_get_swap_slot (uint32_t pte) {
+  ASSERT ((pte & (PTE_P | PTE_SWAP)) == PTE_SWAP);
+  return pte >> PTSHIFT;
+}
+
 #endif /* threads/pte.h */
 
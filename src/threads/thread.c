@@ -462,6 +462,13 @@ init_thread (struct thread *t, const char *name, int priority)
   strlcpy (t->name, name, sizeof t->name);
   t->stack = (uint8_t *) t + PGSIZE;
   t->priority = priority;
+#ifdef USERPROG
+  list_init (&t->children);
+  t->exit_code = -1;
+#endif
+#ifdef VM
+  list_init (&t->mmaps);
+#endif
   t->magic = THREAD_MAGIC;
 
   old_level = intr_disable ();
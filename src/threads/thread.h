@@ -4,6 +4,9 @@
 #include <debug.h>
 #include <list.h>
 #include <stdint.h>
+#ifdef VM
+#include <vm-usage.h>
+#endif
 
 /* States in a thread's life cycle. */
 enum thread_status
@@ -96,6 +99,29 @@ struct thread
 #ifdef USERPROG
     /* Owned by userprog/process.c. */
     uint32_t *pagedir;                  /* Page directory. */
+    struct file *executable;            /* Executable, open while running. */
+    struct fd_table *fds;               /* Open files, or null if none. */
+    struct ring *ring;                  /* Submission rings, or null. */
+    struct kdata *kdata;                /* Kernel data page, or null. */
+    struct trace *trace;                /* System call trace, or null. */
+    uint8_t *heap_start;                /* Start of heap. */
+    uint8_t *heap_break;                /* End of heap, the "break". */
+    int exit_code;                      /* Status for exit message. */
+    void *fpu;                          /* FPU state, or null if unused. */
+    struct child *child;                /* Own process table entry. */
+    struct list children;               /* Children's entries. */
+#endif
+
+#ifdef VM
+    /* Owned by vm/page.c. */
+    struct hash *pages;                 /* Supplemental page table. */
+
+    /* Owned by vm/mmap.c. */
+    struct list mmaps;                  /* Memory-mapped files. */
+    int next_mapid;                     /* Next mapping identifier. */
+
+    /* Updated by vm/frame.c, vm/page.c, userprog/exception.c. */
+    struct vm_usage vm_usage;           /* Memory usage statistics. */
 #endif
 
     /* Owned by thread.c. */
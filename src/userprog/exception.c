@@ -2,13 +2,23 @@
 #include <inttypes.h>
 #include <stdio.h>
 #include "userprog/gdt.h"
+#include "userprog/syscall.h"
+#include "userprog/usermem.h"
+#include "threads/cpu.h"
+#include "threads/flags.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "threads/vaddr.h"
+#ifdef VM
+#include "vm/frame.h"
+#include "vm/page.h"
+#endif
 
 /* Number of page faults processed. */
 static long long page_fault_cnt;
 
 static void kill (struct intr_frame *);
+static void debug (struct intr_frame *);
 static void page_fault (struct intr_frame *);
 
 /* Registers handlers for interrupts that can be caused by user
@@ -20,9 +30,13 @@ static void page_fault (struct intr_frame *);
    signals.  Instead, we'll make them simply kill the user
    process.
 
-   Page faults are an exception.  Here they are treated the same
-   way as other exceptions, but this will need to change to
-   implement virtual memory.
+   Page faults are an exception.  page_fault() passes a fault in
+   a kernel access to user memory back to the code that made it,
+   and with virtual memory it brings in the page that faulted or
+   copies a copy-on-write page.  Only a fault that it cannot
+   resolve kills the process, or panics the kernel if the kernel
+   caused it.  So does a debug exception, except the one that
+   debug() expects on the SYSENTER path.
 
    Refer to [IA32-v3a] section 5.15 "Exception and Interrupt
    Reference" for a description of each of these exceptions. */
@@ -43,10 +57,8 @@ exception_init (void)
      caused indirectly, e.g. #DE can be caused by dividing by
      0.  */
   intr_register_int (0, 0, INTR_ON, kill, "#DE Divide Error");
-  intr_register_int (1, 0, INTR_ON, kill, "#DB Debug Exception");
+  intr_register_int (1, 0, INTR_ON, debug, "#DB Debug Exception");
   intr_register_int (6, 0, INTR_ON, kill, "#UD Invalid Opcode Exception");
-  intr_register_int (7, 0, INTR_ON, kill,
-                     "#NM Device Not Available Exception");
   intr_register_int (11, 0, INTR_ON, kill, "#NP Segment Not Present");
   intr_register_int (12, 0, INTR_ON, kill, "#SS Stack Fault Exception");
   intr_register_int (13, 0, INTR_ON, kill, "#GP General Protection Exception");
@@ -65,6 +77,10 @@ void
 exception_print_stats (void) 
 {
   printf ("Exception: %lld page faults\n", page_fault_cnt);
+#ifdef VM
+  printf ("Exception: %lld pages mapped ahead by fault-around\n",
+          page_mapped_ahead_cnt);
+#endif
 }
 
 /* Handler for an exception (probably) caused by a user process. */
@@ -108,9 +124,30 @@ kill (struct intr_frame *f)
     }
 }
 
-/* Page fault handler.  This is a skeleton that must be filled in
-   to implement virtual memory.  Some solutions to project 2 may
-   also require modifying this code.
+/* Debug exception handler.
+
+   A process that makes a system call through SYSENTER with the
+   trap flag set would have the CPU single-step the kernel: the
+   flag survives SYSENTER, so the CPU traps here right after it,
+   on the SYSENTER stack, before the entry stub has switched to a
+   real kernel stack.  We clear the flag and return to the stub.
+   Interrupts are still off, as SYSENTER left them, so nothing
+   else can run on that stack meanwhile.  Any other debug
+   exception is handled like the rest. */
+static void
+debug (struct intr_frame *f) 
+{
+  if (f->cs == SEL_KCSEG && f->eip == sysenter_entry)
+    f->eflags &= ~FLAG_TF;
+  else
+    kill (f);
+}
+
+/* Page fault handler.  With virtual memory, brings in the page
+   that faulted or gives the process its own copy of a
+   copy-on-write page.  A fault that a kernel access to user
+   memory caused is passed back to it; any other kills the
+   process, or panics the kernel if the kernel caused it.
 
    At entry, the address that faulted is in CR2 (Control Register
    2) and information about the fault, formatted as described in
@@ -126,6 +163,11 @@ page_fault (struct intr_frame *f)
   bool write;        /* True: access was write, false: access was read. */
   bool user;         /* True: access by user, false: access by kernel. */
   void *fault_addr;  /* Fault address. */
+#ifdef VM
+  uint64_t start = rdtsc ();
+  struct vm_usage *usage = &thread_current ()->vm_usage;
+  long long major_faults = usage->major_faults;
+#endif
 
   /* Obtain faulting address, the virtual address that was
      accessed to cause the fault.  It may point to code or to
@@ -148,9 +190,31 @@ page_fault (struct intr_frame *f)
   write = (f->error_code & PF_W) != 0;
   user = (f->error_code & PF_U) != 0;
 
-  /* To implement virtual memory, delete the rest of the function
-     body, and replace it with code that brings in the page to
-     which fault_addr refers. */
+#ifdef VM
+  /* A page that has not been loaded yet, or that was evicted to
+     swap, is brought in, and the faulting instruction restarted.
+     A write to a page shared copy-on-write since fork() gets a
+     private copy of the page.  Either way, the fault is charged
+     to the running process, as a major fault if it had to read
+     from disk. */
+  if ((not_present && is_user_vaddr (fault_addr)
+       && page_in (pg_round_down (fault_addr)))
+      || (!not_present && write && is_user_vaddr (fault_addr)
+          && frame_copy_on_write (pg_round_down (fault_addr))))
+    {
+      if (usage->major_faults == major_faults)
+        usage->minor_faults++;
+      usage->fault_cycles += rdtsc () - start;
+      return;
+    }
+#endif
+
+  /* A kernel access to user memory that the process could not
+     make itself fails back to the primitive that attempted it. */
+  if (!user && usermem_fixup (f))
+    return;
+
+  /* The access was invalid. */
   printf ("Page fault at %p: %s error %s page in %s context.\n",
           fault_addr,
           not_present ? "not present" : "rights violation",
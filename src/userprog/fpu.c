@@ -0,0 +1,228 @@
+#include "userprog/fpu.h"
+#include <debug.h>
+#include <round.h>
+#include <stdint.h>
+#include <string.h>
+#include "threads/cpu.h"
+#include "threads/interrupt.h"
+#include "threads/loader.h"
+#include "threads/malloc.h"
+#include "threads/thread.h"
+
+/* Lazy FPU context switching.
+
+   The kernel never uses the FPU (it is compiled with
+   -msoft-float), but user processes may, so the x87, MMX, and
+   SSE registers are part of a process's context.  Saving and
+   restoring them on every thread switch would cost every switch
+   hundreds of cycles, although most threads never touch the FPU.
+   Instead, we switch them lazily:
+
+     - A thread gets an area to save its FPU state in only when
+       it first executes an FPU instruction.
+
+     - The FPU registers hold the state of at most one thread,
+       fpu_owner.  While any other thread runs, CR0.TS is set,
+       so that its first FPU instruction raises #NM (Device Not
+       Available).
+
+     - The #NM handler saves the registers into the owner's area,
+       loads the running thread's, makes it the owner, and clears
+       CR0.TS, after which the instruction is restarted.
+
+   A thread that does not use the FPU, or that is the only one
+   using it, pays nothing beyond a check of fpu_owner on each
+   thread switch.
+
+   See [IA32-v3a] 13.4 "Designing OS Facilities for Saving x87
+   FPU, SSE and Extended States on Task or Context Switches". */
+
+/* Saved FPU state, in the format of FXSAVE, or of FNSAVE if the
+   CPU does not support FXSAVE. */
+struct fpu_area
+  {
+    uint8_t data[512];
+  }
+__attribute__ ((aligned (16)));
+
+/* Thread whose state is in the FPU registers, if any. */
+static struct thread *fpu_owner;
+
+/* State of a thread that has not used the FPU yet. */
+static struct fpu_area initial_state;
+
+/* Use FXSAVE and FXRSTOR?  Otherwise, FNSAVE and FRSTOR. */
+static bool use_fxsr;
+
+static intr_handler_func fpu_handler;
+static struct fpu_area *area_of (struct thread *);
+static void save (struct fpu_area *);
+static void restore (const struct fpu_area *);
+static void set_ts (void);
+
+/* Enables the FPU for user processes and registers the handler
+   that switches its state between them. */
+void
+fpu_init (void)
+{
+  uint32_t features = cpu_features ();
+  uint32_t cr0;
+
+  /* The boot code sets CR0.EM, which makes every FPU instruction
+     trap.  Run them on the FPU instead, report their errors as
+     #MF exceptions, and make WAIT obey CR0.TS like the rest. */
+  cr0 = cr0_read ();
+  cr0 = (cr0 & ~(CR0_EM | CR0_TS)) | CR0_MP | CR0_NE;
+  cr0_write (cr0);
+
+  /* Enable FXSAVE, and with it SSE, if available. */
+  use_fxsr = (features & CPUID_FXSR) != 0;
+  if (use_fxsr)
+    cr4_write (cr4_read () | CR4_OSFXSR
+               | (features & CPUID_SSE ? CR4_OSXMMEXCPT : 0));
+
+  /* Capture the state that new threads start from. */
+  asm volatile ("fninit");
+  save (&initial_state);
+  set_ts ();
+
+  intr_register_int (7, 0, INTR_ON, fpu_handler,
+                     "#NM Device Not Available Exception");
+}
+
+/* Sets CR0.TS unless the running thread owns the FPU, so that
+   any other thread's first FPU instruction traps.  Called on
+   every thread switch. */
+void
+fpu_activate (void)
+{
+  enum intr_level old_level = intr_disable ();
+  uint32_t cr0 = cr0_read ();
+  uint32_t new_cr0;
+
+  new_cr0 = fpu_owner == thread_current () ? cr0 & ~CR0_TS : cr0 | CR0_TS;
+  if (new_cr0 != cr0)
+    cr0_write (new_cr0);
+  intr_set_level (old_level);
+}
+
+/* Gives the running thread, a child being created by fork(), a
+   copy of PARENT's FPU state.  Returns true if successful, false
+   if memory allocation fails. */
+bool
+fpu_fork (struct thread *parent)
+{
+  struct thread *t = thread_current ();
+  enum intr_level old_level;
+
+  if (parent->fpu == NULL)
+    return true;
+  t->fpu = malloc (sizeof (struct fpu_area) + 15);
+  if (t->fpu == NULL)
+    return false;
+
+  /* Bring PARENT's area up to date.  FNSAVE reinitializes the
+     FPU, so PARENT gives up ownership and reloads its state on
+     its next FPU instruction. */
+  old_level = intr_disable ();
+  if (fpu_owner == parent)
+    {
+      clts ();
+      save (area_of (parent));
+      fpu_owner = NULL;
+      set_ts ();
+    }
+  intr_set_level (old_level);
+
+  memcpy (area_of (t), area_of (parent), sizeof (struct fpu_area));
+  return true;
+}
+
+/* Frees the running thread's FPU state, if any. */
+void
+fpu_exit (void)
+{
+  struct thread *t = thread_current ();
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  if (fpu_owner == t)
+    fpu_owner = NULL;
+  intr_set_level (old_level);
+
+  free (t->fpu);
+  t->fpu = NULL;
+}
+
+/* #NM handler.  Loads the running thread's FPU state, allocating
+   it first if this is its first FPU instruction. */
+static void
+fpu_handler (struct intr_frame *f)
+{
+  struct thread *t = thread_current ();
+  enum intr_level old_level;
+
+  if (f->cs == SEL_KCSEG)
+    {
+      intr_dump_frame (f);
+      PANIC ("Kernel bug - FPU instruction in kernel");
+    }
+
+  if (t->fpu == NULL)
+    {
+      t->fpu = malloc (sizeof (struct fpu_area) + 15);
+      if (t->fpu == NULL)
+        thread_exit ();
+      memcpy (area_of (t), &initial_state, sizeof initial_state);
+    }
+
+  /* A thread switch between here and the return to user mode
+     would set CR0.TS again, so keep interrupts off. */
+  old_level = intr_disable ();
+  clts ();
+  if (fpu_owner != t)
+    {
+      if (fpu_owner != NULL)
+        save (area_of (fpu_owner));
+      restore (area_of (t));
+      fpu_owner = t;
+    }
+  intr_set_level (old_level);
+}
+
+/* Returns T's FPU save area, which must be allocated.  malloc()
+   does not guarantee the 16-byte alignment that FXSAVE requires,
+   so T's allocation has room to align it. */
+static struct fpu_area *
+area_of (struct thread *t)
+{
+  ASSERT (t->fpu != NULL);
+  return (struct fpu_area *) ROUND_UP ((uintptr_t) t->fpu, 16);
+}
+
+/* Saves the FPU registers into AREA.  CR0.TS must be clear. */
+static void
+save (struct fpu_area *area)
+{
+  if (use_fxsr)
+    asm volatile ("fxsave %0" : "=m" (*area));
+  else
+    asm volatile ("fnsave %0" : "=m" (*area));
+}
+
+/* Loads the FPU registers from AREA.  CR0.TS must be clear. */
+static void
+restore (const struct fpu_area *area)
+{
+  if (use_fxsr)
+    asm volatile ("fxrstor %0" : : "m" (*area));
+  else
+    asm volatile ("frstor %0" : : "m" (*area));
+}
+
+/* Sets CR0.TS. */
+static void
+set_ts (void)
+{
+  cr0_write (cr0_read () | CR0_TS);
+}
@@ -0,0 +1,13 @@
+#ifndef USERPROG_FPU_H
+#define USERPROG_FPU_H
+
+#include <stdbool.h>
+
+struct thread;
+
+void fpu_init (void);
+void fpu_activate (void);
+bool fpu_fork (struct thread *parent);
+void fpu_exit (void);
+
+#endif /* userprog/fpu.h */
@@ -0,0 +1,56 @@
+#include "userprog/kdata.h"
+#include <kdata.h>
+#include "userprog/pagedir.h"
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* Maps a new kernel data page (see lib/kdata.h) for the running
+   process at KDATA_ADDR.  Returns true if successful, false if
+   that address is taken or no page is available.  The page
+   belongs to the process's address space, which frees it when
+   the process exits. */
+bool
+kdata_map (void)
+{
+  struct thread *t = thread_current ();
+  struct kdata *k;
+
+  k = palloc_get_page (PAL_USER | PAL_ZERO);
+  if (k == NULL)
+    return false;
+  if (pagedir_get_page (t->pagedir, KDATA_ADDR) != NULL
+      || !pagedir_set_page (t->pagedir, KDATA_ADDR, k, false))
+    {
+      palloc_free_page (k);
+      return false;
+    }
+
+  k->timer_freq = TIMER_FREQ;
+  k->pid = t->tid;
+  t->kdata = k;
+  kdata_update (timer_ticks ());
+  return true;
+}
+
+/* Sets the tick count in the running process's kernel data page,
+   if it has one, to TICKS.  Called on every timer tick and every
+   switch to a process. */
+void
+kdata_update (int64_t ticks)
+{
+  struct kdata *k = thread_current ()->kdata;
+
+  if (k != NULL)
+    {
+      enum intr_level old_level = intr_disable ();
+      k->seq++;
+      barrier ();
+      k->ticks = ticks;
+      barrier ();
+      k->seq++;
+      intr_set_level (old_level);
+    }
+}
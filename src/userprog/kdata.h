@@ -0,0 +1,10 @@
+#ifndef USERPROG_KDATA_H
+#define USERPROG_KDATA_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+bool kdata_map (void);
+void kdata_update (int64_t ticks);
+
+#endif /* userprog/kdata.h */
@@ -3,8 +3,13 @@
 #include <stddef.h>
 #include <string.h>
 #include "threads/init.h"
+#include "threads/interrupt.h"
 #include "threads/pte.h"
 #include "threads/palloc.h"
+#ifdef VM
+#include "vm/frame.h"
+#include "vm/swap.h"
+#endif
 
 static uint32_t *active_pd (void);
 static void invalidate_pagedir (uint32_t *);
@@ -41,7 +46,17 @@ pagedir_destroy (uint32_t *pd)
         
         for (pte = pt; pte < pt + PGSIZE / sizeof *pte; pte++)
           if (*pte & PTE_P) 
-            palloc_free_page (pte_get_page (*pte));
+            {
+#ifdef VM
+              if (frame_is_zero (pte_get_page (*pte)))
+                continue;
+#endif
+              palloc_free_page (pte_get_page (*pte));
+            }
+#ifdef VM
+          else if (*pte & PTE_SWAP)
+            swap_free (pte_get_swap_slot (*pte));
+#endif
         palloc_free_page (pt);
       }
   palloc_free_page (pd);
@@ -156,6 +171,268 @@ pagedir_clear_page (uint32_t *pd, void *upage)
     }
 }
 
+/* Marks user virtual page UPAGE "not present" in page directory
+   PD, like pagedir_clear_page(), and returns true if it was
+   dirty.  Interrupts are disabled across the update, as in
+   pagedir_set_swapped().  UPAGE need not be mapped. */
+bool
+pagedir_unmap_page (uint32_t *pd, void *upage)
+{
+  enum intr_level old_level;
+  uint32_t *pte;
+  bool dirty = false;
+
+  ASSERT (pg_ofs (upage) == 0);
+  ASSERT (is_user_vaddr (upage));
+
+  pte = lookup_page (pd, upage, false);
+  if (pte != NULL && (*pte & PTE_P) != 0)
+    {
+      old_level = intr_disable ();
+      dirty = (*pte & PTE_D) != 0;
+      *pte &= ~(uint32_t) PTE_P;
+      invalidate_pagedir (pd);
+      intr_set_level (old_level);
+    }
+  return dirty;
+}
+
+/* Replaces the mapping for user virtual page UPAGE in PD, which
+   must be present, by a not-present entry recording that the
+   page's contents now belong in swap slot SLOT.  The page keeps
+   its writability for when it is brought back in; a
+   copy-on-write page will be brought back into a frame of its
+   own, so it becomes plainly writable.
+   Returns true if the page was dirty.
+
+   Interrupts are disabled across the update, so that a write to
+   the page cannot slip in between reading the dirty bit and
+   clearing the mapping. */
+bool
+pagedir_set_swapped (uint32_t *pd, void *upage, size_t slot)
+{
+  enum intr_level old_level;
+  uint32_t *pte;
+  bool dirty;
+
+  ASSERT (pg_ofs (upage) == 0);
+  ASSERT (is_user_vaddr (upage));
+
+  pte = lookup_page (pd, upage, false);
+  ASSERT (pte != NULL && (*pte & PTE_P) != 0);
+
+  old_level = intr_disable ();
+  dirty = (*pte & PTE_D) != 0;
+  *pte = pte_create_swap (slot, (*pte & (PTE_W | PTE_COW)) != 0);
+  invalidate_pagedir (pd);
+  intr_set_level (old_level);
+
+  return dirty;
+}
+
+/* If user virtual page UPAGE in PD has been swapped out by
+   pagedir_set_swapped(), stores its swap slot into *SLOT and its
+   writability into *WRITABLE and returns true.  Otherwise,
+   returns false. */
+bool
+pagedir_get_swapped (uint32_t *pd, const void *upage, size_t *slot,
+                     bool *writable)
+{
+  uint32_t *pte;
+
+  ASSERT (is_user_vaddr (upage));
+
+  pte = lookup_page (pd, upage, false);
+  if (pte == NULL || (*pte & (PTE_P | PTE_SWAP)) != PTE_SWAP)
+    return false;
+
+  *slot = pte_get_swap_slot (*pte);
+  *writable = (*pte & PTE_W) != 0;
+  return true;
+}
+
+/* If user virtual page UPAGE in PD has been swapped out by
+   pagedir_set_swapped(), removes it from PD, stores the swap
+   slot it referred to into *SLOT, and returns true.  The caller
+   becomes responsible for the slot's reference.  Otherwise,
+   returns false. */
+bool
+pagedir_clear_swapped (uint32_t *pd, void *upage, size_t *slot)
+{
+  uint32_t *pte;
+
+  ASSERT (pg_ofs (upage) == 0);
+  ASSERT (is_user_vaddr (upage));
+
+  pte = lookup_page (pd, upage, false);
+  if (pte == NULL || (*pte & (PTE_P | PTE_SWAP)) != PTE_SWAP)
+    return false;
+
+  *slot = pte_get_swap_slot (*pte);
+  *pte = 0;
+  return true;
+}
+
+/* Maps user virtual page UPAGE in page directory DST to the same
+   frame as in SRC, where it must be present, for fork().  If the
+   page is writable in SRC, it becomes read-only and
+   copy-on-write in both page directories.  UPAGE must not
+   already be mapped in DST.
+   Returns true if successful, false if memory allocation
+   failed. */
+bool
+pagedir_share_page (uint32_t *dst, uint32_t *src, void *upage)
+{
+  uint32_t *src_pte, *dst_pte;
+
+  ASSERT (pg_ofs (upage) == 0);
+  ASSERT (is_user_vaddr (upage));
+
+  src_pte = lookup_page (src, upage, false);
+  ASSERT (src_pte != NULL && (*src_pte & PTE_P) != 0);
+
+  dst_pte = lookup_page (dst, upage, true);
+  if (dst_pte == NULL)
+    return false;
+  ASSERT ((*dst_pte & PTE_P) == 0);
+
+  if (*src_pte & PTE_W)
+    {
+      *src_pte = (*src_pte & ~(uint32_t) PTE_W) | PTE_COW;
+      invalidate_pagedir (src);
+    }
+  *dst_pte = *src_pte & ~(uint32_t) PTE_A;
+  return true;
+}
+
+/* Maps user virtual page UPAGE to KPAGE in PD like
+   pagedir_set_page() with RW false, but copy-on-write, so that a
+   write to the page faults and may be given a copy of it.
+   Returns true if successful, false if memory allocation
+   failed. */
+bool
+pagedir_set_page_cow (uint32_t *pd, void *upage, void *kpage)
+{
+  uint32_t *pte;
+
+  if (!pagedir_set_page (pd, upage, kpage, false))
+    return false;
+  pte = lookup_page (pd, upage, false);
+  *pte |= PTE_COW;
+  return true;
+}
+
+/* Points user virtual page UPAGE, which must be present in PD,
+   at KPAGE, which must hold the same contents, when frames are
+   merged.  The page becomes read-only, or copy-on-write if it
+   was writable.  Its accessed and dirty bits are kept. */
+void
+pagedir_merge_page (uint32_t *pd, void *upage, void *kpage)
+{
+  uint32_t *pte = lookup_page (pd, upage, false);
+
+  ASSERT (pte != NULL && (*pte & PTE_P) != 0);
+  ASSERT (pg_ofs (kpage) == 0);
+
+  if (*pte & PTE_W)
+    *pte = (*pte & ~(uint32_t) PTE_W) | PTE_COW;
+  *pte = vtop (kpage) | (*pte & PTE_FLAGS);
+  invalidate_pagedir (pd);
+}
+
+/* Returns true if user virtual page UPAGE is mapped copy-on-write
+   in PD. */
+bool
+pagedir_is_cow (uint32_t *pd, const void *upage)
+{
+  uint32_t *pte = lookup_page (pd, upage, false);
+  return pte != NULL && (*pte & (PTE_P | PTE_COW)) == (PTE_P | PTE_COW);
+}
+
+/* Makes copy-on-write page UPAGE in PD, which is no longer shared
+   with any other page directory, plainly writable. */
+void
+pagedir_clear_cow (uint32_t *pd, const void *upage)
+{
+  uint32_t *pte = lookup_page (pd, upage, false);
+
+  ASSERT (pte != NULL && (*pte & (PTE_P | PTE_COW)) == (PTE_P | PTE_COW));
+  *pte = (*pte & ~(uint32_t) PTE_COW) | PTE_W;
+  invalidate_pagedir (pd);
+}
+
+#ifdef VM
+/* Copies every user page table entry in SRC that refers to a
+   swap slot into DST, adding a reference to the slot, for
+   fork().  Returns true if successful, false if memory
+   allocation failed. */
+bool
+pagedir_dup_swapped (uint32_t *dst, uint32_t *src)
+{
+  uint32_t *pde;
+
+  for (pde = src; pde < src + pd_no (PHYS_BASE); pde++)
+    if (*pde & PTE_P)
+      {
+        uint32_t *pt = pde_get_pt (*pde);
+        size_t i;
+
+        for (i = 0; i < PGSIZE / sizeof *pt; i++)
+          if ((pt[i] & (PTE_P | PTE_SWAP)) == PTE_SWAP)
+            {
+              void *upage = (void *) (((pde - src) << PDSHIFT)
+                                      | (i << PTSHIFT));
+              uint32_t *pte = lookup_page (dst, upage, true);
+              if (pte == NULL)
+                return false;
+              swap_dup (pte_get_swap_slot (pt[i]));
+              *pte = pt[i];
+            }
+      }
+  return true;
+}
+#else
+/* Maps a copy of every user page in SRC at the same address in
+   DST, for fork().  The copies are obtained from the user pool.
+   Pages that DST maps already, such as its kernel data page, are
+   left alone.  Returns true if successful, false if memory
+   allocation failed. */
+bool
+pagedir_copy (uint32_t *dst, uint32_t *src)
+{
+  uint32_t *pde;
+
+  for (pde = src; pde < src + pd_no (PHYS_BASE); pde++)
+    if (*pde & PTE_P)
+      {
+        uint32_t *pt = pde_get_pt (*pde);
+        size_t i;
+
+        for (i = 0; i < PGSIZE / sizeof *pt; i++)
+          if (pt[i] & PTE_P)
+            {
+              void *upage = (void *) (((pde - src) << PDSHIFT)
+                                      | (i << PTSHIFT));
+              void *kpage;
+
+              if (pagedir_get_page (dst, upage) != NULL)
+                continue;
+              kpage = palloc_get_page (PAL_USER);
+              if (kpage == NULL)
+                return false;
+              memcpy (kpage, pte_get_page (pt[i]), PGSIZE);
+              if (!pagedir_set_page (dst, upage, kpage,
+                                     (pt[i] & PTE_W) != 0))
+                {
+                  palloc_free_page (kpage);
+                  return false;
+                }
+            }
+      }
+  return true;
+}
+#endif
+
 /* Returns true if the PTE for virtual page VPAGE in PD is dirty,
    that is, if the page has been modified since the PTE was
    installed.
@@ -226,7 +503,11 @@ pagedir_activate (uint32_t *pd)
      aka PDBR (page directory base register).  This activates our
      new page tables immediately.  See [IA32-v2a] "MOV--Move
      to/from Control Registers" and [IA32-v3a] 3.7.5 "Base
-     Address of the Page Directory". */
+     Address of the Page Directory".
+
+     The load flushes only non-global TLB entries.  Kernel
+     mappings are global when the CPU supports it (see
+     paging_init()), so they survive the switch. */
   asm volatile ("movl %0, %%cr3" : : "r" (vtop (pd)) : "memory");
 }
 
@@ -2,6 +2,7 @@
 #define USERPROG_PAGEDIR_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 uint32_t *pagedir_create (void);
@@ -9,6 +10,21 @@ void pagedir_destroy (uint32_t *pd);
 bool pagedir_set_page (uint32_t *pd, void *upage, void *kpage, bool rw);
 void *pagedir_get_page (uint32_t *pd, const void *upage);
 void pagedir_clear_page (uint32_t *pd, void *upage);
+bool pagedir_unmap_page (uint32_t *pd, void *upage);
+bool pagedir_set_swapped (uint32_t *pd, void *upage, size_t slot);
+bool pagedir_get_swapped (uint32_t *pd, const void *upage, size_t *slot,
+                          bool *writable);
+bool pagedir_clear_swapped (uint32_t *pd, void *upage, size_t *slot);
+bool pagedir_share_page (uint32_t *dst, uint32_t *src, void *upage);
+bool pagedir_set_page_cow (uint32_t *pd, void *upage, void *kpage);
+void pagedir_merge_page (uint32_t *pd, void *upage, void *kpage);
+bool pagedir_is_cow (uint32_t *pd, const void *upage);
+void pagedir_clear_cow (uint32_t *pd, const void *upage);
+#ifdef VM
+bool pagedir_dup_swapped (uint32_t *dst, uint32_t *src);
+#else
+bool pagedir_copy (uint32_t *dst, uint32_t *src);
+#endif
 bool pagedir_is_dirty (uint32_t *pd, const void *upage);
 void pagedir_set_dirty (uint32_t *pd, const void *upage, bool dirty);
 bool pagedir_is_accessed (uint32_t *pd, const void *upage);
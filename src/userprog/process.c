@@ -1,71 +1,189 @@
 #include "userprog/process.h"
+#include <bitmap.h>
 #include <debug.h>
+#include <hash.h>
 #include <inttypes.h>
 #include <round.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "userprog/fpu.h"
 #include "userprog/gdt.h"
+#include "userprog/kdata.h"
 #include "userprog/pagedir.h"
+#include "userprog/ring.h"
+#include "userprog/syscall.h"
+#include "userprog/trace.h"
 #include "userprog/tss.h"
+#include "devices/timer.h"
 #include "filesys/directory.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
+#include "threads/cpu.h"
 #include "threads/flags.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
+#ifdef VM
+#include "vm/frame.h"
+#include "vm/mmap.h"
+#include "vm/page.h"
+#endif
+
+/* Exec latency statistics: the number of processes started and
+   the total time, in CPU cycles, from the moment each began
+   running until it executed its first instruction.  Without
+   virtual memory, this includes reading the whole executable;
+   with it, only its headers, the rest being read on demand. */
+static long long exec_cnt;
+static long long exec_cycles;
+
+#ifdef VM
+/* Print each process's memory usage when it exits?
+   Controlled by kernel command-line option "-vmstat". */
+bool process_vm_report;
+#endif
+
+/* A user process's entry in the process table.
+
+   Every user process has one, from the moment its parent creates
+   it until the process has exited and its parent has either
+   waited for it or exited itself, whichever comes last.  The
+   record thus outlives the process's thread, keeping its exit
+   status for the parent to collect at any time.
+
+   The process table is a hash table keyed by thread id that
+   holds the records that their parents can still wait for, so
+   that wait() finds a child in constant time without scanning
+   the list of all threads.  A parent also keeps a list of its
+   children's records, to let go of them when it exits. */
+struct child
+  {
+    struct hash_elem hash_elem; /* Element in process_table. */
+    struct list_elem list_elem; /* Element in parent's children list. */
+    tid_t tid;                  /* Process's thread id. */
+    struct thread *parent;      /* Parent process. */
+    struct semaphore started;   /* Upped when process has loaded. */
+    bool start_success;         /* Did it load successfully? */
+    struct semaphore exited;    /* Upped when process exits. */
+    int exit_code;              /* Exit status, once exited. */
+    int ref_cnt;                /* 2 while parent and process live. */
+  };
+
+/* Process table, and lock that protects it and the ref_cnt
+   members of its records. */
+static struct hash process_table;
+static struct lock process_lock;
 
 static thread_func start_process NO_RETURN;
-static bool load (const char *cmdline, void (**eip) (void), void **esp);
+static thread_func start_fork NO_RETURN;
+static bool load (char *cmd_line, void (**eip) (void), void **esp);
+static struct child *create_child (void);
+static tid_t start_child (struct child *, const char *name,
+                          thread_func *, void *aux);
+static void forget_child (struct child *);
+static bool grow_fds (size_t cnt);
+static void unref_child (struct child *);
+static hash_hash_func child_hash;
+static hash_less_func child_less;
+
+/* Initializes the process table. */
+void
+process_init (void)
+{
+  hash_init (&process_table, child_hash, child_less, NULL);
+  lock_init (&process_lock);
+}
+
+/* What a process calling exec() hands over to its child. */
+struct exec_info
+  {
+    char *file_name;            /* Page with program to load, or null
+                                   once the child has taken it. */
+    struct child *child;        /* Child's process table entry. */
+  };
 
 /* Starts a new thread running a user program loaded from
-   FILENAME.  The new thread may be scheduled (and may even exit)
-   before process_execute() returns.  Returns the new process's
-   thread id, or TID_ERROR if the thread cannot be created. */
+   FILENAME, and waits until it has been loaded.  FILENAME is a
+   command line: the program's name, followed by its arguments,
+   separated by spaces.  Returns the new process's thread id, or
+   TID_ERROR if the thread cannot be created or the program
+   cannot be loaded. */
 tid_t
 process_execute (const char *file_name) 
 {
-  char *fn_copy;
+  struct exec_info info;
+  char name[16];
   tid_t tid;
 
   /* Make a copy of FILE_NAME.
      Otherwise there's a race between the caller and load(). */
-  fn_copy = palloc_get_page (0);
-  if (fn_copy == NULL)
+  info.file_name = palloc_get_page (0);
+  if (info.file_name == NULL)
     return TID_ERROR;
-  strlcpy (fn_copy, file_name, PGSIZE);
+  strlcpy (info.file_name, file_name, PGSIZE);
 
-  /* Create a new thread to execute FILE_NAME. */
-  tid = thread_create (file_name, PRI_DEFAULT, start_process, fn_copy);
-  if (tid == TID_ERROR)
-    palloc_free_page (fn_copy); 
+  info.child = create_child ();
+  if (info.child == NULL)
+    {
+      palloc_free_page (info.file_name);
+      return TID_ERROR;
+    }
+
+  /* Name the thread after the program. */
+  file_name += strspn (file_name, " ");
+  strlcpy (name, file_name, sizeof name);
+  name[strcspn (name, " ")] = '\0';
+
+  /* Create a new thread to execute FILE_NAME.  Once the thread
+     runs, the copy is its to free; if it was never created, the
+     copy is still ours. */
+  tid = start_child (info.child, name, start_process, &info);
+  palloc_free_page (info.file_name);
   return tid;
 }
 
 /* A thread function that loads a user process and starts it
    running. */
 static void
-start_process (void *file_name_)
+start_process (void *info_)
 {
-  char *file_name = file_name_;
+  struct exec_info *info = info_;
+  char *file_name = info->file_name;
+  struct thread *t = thread_current ();
+  uint64_t start = rdtsc ();
   struct intr_frame if_;
   bool success;
 
+  t->child = info->child;
+  info->file_name = NULL;
+
   /* Initialize interrupt frame and load executable. */
   memset (&if_, 0, sizeof if_);
   if_.gs = if_.fs = if_.es = if_.ds = if_.ss = SEL_UDSEG;
   if_.cs = SEL_UCSEG;
   if_.eflags = FLAG_IF | FLAG_MBS;
   success = load (file_name, &if_.eip, &if_.esp);
+  palloc_free_page (file_name);
+
+  /* Tell the parent how loading went.  INFO belongs to the
+     parent, which may return as soon as we signal it. */
+  t->child->start_success = success;
+  sema_up (&t->child->started);
 
   /* If load failed, quit. */
-  palloc_free_page (file_name);
   if (!success) 
     thread_exit ();
 
+  exec_cnt++;
+  exec_cycles += rdtsc () - start;
+  if (trace_all)
+    trace_start ();
+
   /* Start the user process by simulating a return from an
      interrupt, implemented by intr_exit (in
      threads/intr-stubs.S).  Because intr_exit takes all of its
@@ -76,19 +194,157 @@ start_process (void *file_name_)
   NOT_REACHED ();
 }
 
+/* A process's open files, indexed by file descriptor.
+
+   The table grows by doubling, up to FD_MAX handles, so that
+   looking up a handle takes constant time however many files are
+   open.  A bitmap of the handles in use finds the lowest free
+   one, as POSIX requires of open() and dup(), starting from a
+   hint below which no handle is free.
+
+   Handles 0 and 1 belong to the console.  They are always marked
+   in use but have no file.
+
+   A process's ring worker (see userprog/ring.c) shares its table,
+   so both use the table, and the files in it, only while holding
+   the file system lock. */
+struct fd_table
+  {
+    struct file **files;        /* Open files, indexed by handle. */
+    struct bitmap *used;        /* Handles in use. */
+    size_t free_hint;           /* No handle below this is free. */
+  };
+
+/* Number of handles a new table has room for. */
+#define FD_INIT 16
+
+/* Most handles a process may have, including the console's. */
+#define FD_MAX 1024
+
+/* What a process calling fork() hands over to its child. */
+struct fork_info
+  {
+    struct intr_frame if_;      /* Parent's user registers. */
+    struct thread *parent;      /* Parent process. */
+    struct child *child;        /* Child's process table entry. */
+  };
+
+/* Creates a child of the running process with a copy of its
+   address space, which resumes user execution with the register
+   values in F, except that it sees fork() return 0.  Returns the
+   child's thread id, or TID_ERROR if it cannot be created.
+
+   The child copies the address space itself, while the parent
+   waits, so that everything it allocates is charged to it.  With
+   virtual memory, parent and child share all their pages
+   copy-on-write, so that creating the child costs time in
+   proportion to the number of pages the two processes
+   eventually write, not the size of the address space.
+   Otherwise, every page is copied up front. */
+tid_t
+process_fork (const struct intr_frame *f)
+{
+  struct thread *cur = thread_current ();
+  struct fork_info info;
+
+  info.if_ = *f;
+  info.parent = cur;
+  info.child = create_child ();
+  if (info.child == NULL)
+    return TID_ERROR;
+  return start_child (info.child, cur->name, start_fork, &info);
+}
+
+/* A thread function that copies the address space of the parent
+   described by INFO_, which waits meanwhile, and returns to user
+   mode as the child. */
+static void
+start_fork (void *info_)
+{
+  struct fork_info *info = info_;
+  struct thread *parent = info->parent;
+  struct thread *t = thread_current ();
+  struct intr_frame if_ = info->if_;
+  bool traced = trace_all || parent->trace != NULL;
+  bool success;
+
+  t->child = info->child;
+  t->heap_start = parent->heap_start;
+  t->heap_break = parent->heap_break;
+  lock_acquire (&fs_lock);
+  t->executable = file_reopen (parent->executable);
+  if (t->executable != NULL)
+    file_deny_write (t->executable);
+  lock_release (&fs_lock);
+  t->pagedir = pagedir_create ();
+  success = t->executable != NULL && t->pagedir != NULL && kdata_map ();
+  if (success)
+    {
+#ifdef VM
+      t->pages = page_table_copy (parent->pages, parent->executable,
+                                  t->executable);
+      success = t->pages != NULL && frame_fork (parent->pagedir);
+#else
+      success = pagedir_copy (t->pagedir, parent->pagedir);
+#endif
+      if (success)
+        success = fpu_fork (parent);
+    }
+
+  /* INFO belongs to the parent, which may return as soon as we
+     signal it. */
+  t->child->start_success = success;
+  sema_up (&t->child->started);
+  if (!success)
+    thread_exit ();
+  process_activate ();
+
+  /* A traced process's children are traced too. */
+  if (traced)
+    trace_start ();
+
+  /* fork() returns 0 in the child. */
+  if_.eax = 0;
+  asm volatile ("movl %0, %%esp; jmp intr_exit" : : "g" (&if_) : "memory");
+  NOT_REACHED ();
+}
+
 /* Waits for thread TID to die and returns its exit status.  If
    it was terminated by the kernel (i.e. killed due to an
    exception), returns -1.  If TID is invalid or if it was not a
    child of the calling process, or if process_wait() has already
    been successfully called for the given TID, returns -1
-   immediately, without waiting.
-
-   This function will be implemented in problem 2-2.  For now, it
-   does nothing. */
+   immediately, without waiting. */
 int
-process_wait (tid_t child_tid UNUSED) 
+process_wait (tid_t child_tid) 
 {
-  return -1;
+  struct child key;
+  struct child *c = NULL;
+  struct hash_elem *e;
+  int exit_code;
+
+  key.tid = child_tid;
+  lock_acquire (&process_lock);
+  e = hash_find (&process_table, &key.hash_elem);
+  if (e != NULL)
+    {
+      /* Another process's record may be freed as soon as we
+         release the lock, so check whose it is first.  Only the
+         parent removes a record from the table, so C cannot go
+         away under us if it is ours. */
+      c = hash_entry (e, struct child, hash_elem);
+      if (c->parent != thread_current ())
+        c = NULL;
+    }
+  lock_release (&process_lock);
+
+  if (c == NULL)
+    return -1;
+
+  sema_down (&c->exited);
+  exit_code = c->exit_code;
+  forget_child (c);
+  return exit_code;
 }
 
 /* Free the current process's resources. */
@@ -98,6 +354,32 @@ process_exit (void)
   struct thread *cur = thread_current ();
   uint32_t *pd;
 
+  if (cur->pagedir != NULL)
+    printf ("%s: exit(%d)\n", cur->name, cur->exit_code);
+
+  /* Stop the ring worker, which uses our files and memory. */
+  ring_exit ();
+  trace_stop ();
+
+#ifdef VM
+  if (process_vm_report && cur->pagedir != NULL)
+    {
+      struct vm_usage *u = &cur->vm_usage;
+      printf ("%s: %lld minor faults, %lld major faults, "
+              "%lld pages swapped in, %lld swapped out, "
+              "%"PRIu32" resident pages (peak %"PRIu32"), "
+              "%"PRIu64" cycles in faults\n",
+              cur->name, u->minor_faults, u->major_faults, u->swap_ins,
+              u->swap_outs, u->rss, u->peak_rss, u->fault_cycles);
+    }
+
+  /* Write back memory-mapped files while the address space is
+     still intact. */
+  lock_acquire (&fs_lock);
+  mmap_unmap_all ();
+  lock_release (&fs_lock);
+#endif
+
   /* Destroy the current process's page directory and switch back
      to the kernel-only page directory. */
   pd = cur->pagedir;
@@ -111,9 +393,219 @@ process_exit (void)
          directory, or our active page directory will be one
          that's been freed (and cleared). */
       cur->pagedir = NULL;
+      cur->kdata = NULL;
       pagedir_activate (NULL);
+#ifdef VM
+      frame_free_all (pd);
+#endif
       pagedir_destroy (pd);
     }
+#ifdef VM
+  page_table_destroy (cur->pages);
+  cur->pages = NULL;
+#endif
+
+  /* Close the process's files, and the executable only now that
+     no page can be read from it any longer. */
+  if (cur->fds != NULL || cur->executable != NULL)
+    {
+      lock_acquire (&fs_lock);
+      if (cur->fds != NULL)
+        {
+          size_t handle;
+
+          for (handle = 0; handle < bitmap_size (cur->fds->used); handle++)
+            file_close (cur->fds->files[handle]);
+          free (cur->fds->files);
+          bitmap_destroy (cur->fds->used);
+          free (cur->fds);
+          cur->fds = NULL;
+        }
+      file_close (cur->executable);
+      cur->executable = NULL;
+      lock_release (&fs_lock);
+    }
+
+  fpu_exit ();
+
+  /* Report our exit status to our parent, now that we have
+     released everything, and let go of our own children. */
+  if (cur->child != NULL)
+    {
+      cur->child->exit_code = cur->exit_code;
+      sema_up (&cur->child->exited);
+      unref_child (cur->child);
+      cur->child = NULL;
+    }
+  while (!list_empty (&cur->children))
+    forget_child (list_entry (list_front (&cur->children),
+                              struct child, list_elem));
+}
+
+/* Adds FILE to the running process's open files as the lowest
+   free file descriptor and returns it, or returns -1 if the
+   process has FD_MAX handles open or memory allocation fails. */
+int
+process_add_file (struct file *file)
+{
+  struct fd_table *fds;
+  size_t handle;
+
+  if (!grow_fds (0))
+    return -1;
+  fds = thread_current ()->fds;
+  handle = bitmap_scan_and_flip (fds->used, fds->free_hint, 1, false);
+  if (handle == BITMAP_ERROR)
+    {
+      if (!grow_fds (bitmap_size (fds->used) + 1))
+        return -1;
+      handle = bitmap_scan_and_flip (fds->used, fds->free_hint, 1, false);
+    }
+  fds->files[handle] = file;
+  fds->free_hint = handle + 1;
+  return handle;
+}
+
+/* Returns the file open as file descriptor HANDLE in the running
+   process, or a null pointer if HANDLE is not open. */
+struct file *
+process_get_file (int handle)
+{
+  struct fd_table *fds = thread_current ()->fds;
+
+  if (fds == NULL || handle < 0
+      || (size_t) handle >= bitmap_size (fds->used))
+    return NULL;
+  return fds->files[handle];
+}
+
+/* Closes file descriptor HANDLE of the running process.  Returns
+   false if HANDLE was not open. */
+bool
+process_close_file (int handle)
+{
+  struct fd_table *fds = thread_current ()->fds;
+  struct file *file = process_get_file (handle);
+
+  if (file == NULL)
+    return false;
+  file_close (file);
+  fds->files[handle] = NULL;
+  bitmap_reset (fds->used, handle);
+  if ((size_t) handle < fds->free_hint)
+    fds->free_hint = handle;
+  return true;
+}
+
+/* Opens the file open as file descriptor HANDLE in the running
+   process as the lowest free file descriptor as well, sharing
+   its file position, and returns the new descriptor.  Returns -1
+   if HANDLE is not open or no descriptor can be allocated. */
+int
+process_dup_file (int handle)
+{
+  struct file *file = process_get_file (handle);
+  int new_handle;
+
+  if (file == NULL)
+    return -1;
+  new_handle = process_add_file (file_dup (file));
+  if (new_handle == -1)
+    file_close (file);
+  return new_handle;
+}
+
+/* Makes file descriptor NEW_HANDLE of the running process refer
+   to the file open as HANDLE, sharing its file position, closing
+   whatever NEW_HANDLE referred to before.  Returns NEW_HANDLE, or
+   -1 if HANDLE is not open, if NEW_HANDLE is a console handle or
+   is too large, or if memory allocation fails. */
+int
+process_dup2_file (int handle, int new_handle)
+{
+  struct file *file = process_get_file (handle);
+  struct fd_table *fds;
+
+  if (file == NULL || new_handle < 2 || new_handle >= FD_MAX)
+    return -1;
+  if (new_handle == handle)
+    return new_handle;
+  if (!grow_fds (new_handle + 1))
+    return -1;
+
+  fds = thread_current ()->fds;
+  process_close_file (new_handle);
+  fds->files[new_handle] = file_dup (file);
+  bitmap_mark (fds->used, new_handle);
+  return new_handle;
+}
+
+/* Returns the running process's file descriptor table, creating
+   it if necessary, so that a kernel thread acting for the process
+   can share it.  Returns a null pointer if memory allocation
+   fails. */
+struct fd_table *
+process_file_table (void)
+{
+  return grow_fds (0) ? thread_current ()->fds : NULL;
+}
+
+/* Makes sure that the running process has a file descriptor
+   table with room for at least CNT handles.  Returns true if
+   successful, false if CNT exceeds FD_MAX or memory allocation
+   fails. */
+static bool
+grow_fds (size_t cnt)
+{
+  struct thread *cur = thread_current ();
+  struct fd_table *fds = cur->fds;
+  size_t old_cnt, new_cnt;
+  struct file **files;
+  struct bitmap *used;
+
+  if (fds == NULL)
+    {
+      fds = malloc (sizeof *fds);
+      if (fds == NULL)
+        return false;
+      fds->files = NULL;
+      fds->used = NULL;
+      fds->free_hint = 2;
+      cur->fds = fds;
+    }
+
+  old_cnt = fds->used != NULL ? bitmap_size (fds->used) : 0;
+  if (cnt <= old_cnt && fds->used != NULL)
+    return true;
+  if (cnt > FD_MAX)
+    return false;
+  for (new_cnt = old_cnt > 0 ? old_cnt * 2 : FD_INIT; new_cnt < cnt;
+       new_cnt *= 2)
+    continue;
+  if (new_cnt > FD_MAX)
+    new_cnt = FD_MAX;
+
+  files = realloc (fds->files, new_cnt * sizeof *files);
+  if (files == NULL)
+    return false;
+  memset (files + old_cnt, 0, (new_cnt - old_cnt) * sizeof *files);
+  fds->files = files;
+
+  used = bitmap_create (new_cnt);
+  if (used == NULL)
+    return false;
+  if (fds->used != NULL)
+    {
+      size_t handle;
+
+      for (handle = 0; handle < old_cnt; handle++)
+        bitmap_set (used, handle, bitmap_test (fds->used, handle));
+      bitmap_destroy (fds->used);
+    }
+  else
+    bitmap_set_multiple (used, 0, 2, true);
+  fds->used = used;
+  return true;
 }
 
 /* Sets up the CPU for running user code in the current
@@ -130,6 +622,112 @@ process_activate (void)
   /* Set thread's kernel stack for use in processing
      interrupts. */
   tss_update ();
+
+  /* Make the FPU trap unless it holds the thread's state. */
+  fpu_activate ();
+
+  /* Bring the thread's view of the time up to date. */
+  kdata_update (timer_ticks ());
+}
+
+/* Creates and returns a process table entry for a child of the
+   running process that is about to be started, or returns a null
+   pointer if memory allocation fails. */
+static struct child *
+create_child (void)
+{
+  struct child *c = malloc (sizeof *c);
+  if (c != NULL)
+    {
+      c->tid = TID_ERROR;
+      c->parent = thread_current ();
+      sema_init (&c->started, 0);
+      c->start_success = false;
+      sema_init (&c->exited, 0);
+      c->exit_code = -1;
+      c->ref_cnt = 2;
+    }
+  return c;
+}
+
+/* Creates a thread named NAME that runs FUNCTION, passing AUX,
+   to be the child process described by C, which the new thread
+   takes over.  Waits until FUNCTION reports through C whether
+   the process started.  Returns the new process's thread id, or
+   TID_ERROR if it could not be created or did not start. */
+static tid_t
+start_child (struct child *c, const char *name, thread_func *function,
+             void *aux)
+{
+  c->tid = thread_create (name, PRI_DEFAULT, function, aux);
+  if (c->tid == TID_ERROR)
+    {
+      free (c);
+      return TID_ERROR;
+    }
+
+  lock_acquire (&process_lock);
+  hash_insert (&process_table, &c->hash_elem);
+  lock_release (&process_lock);
+  list_push_back (&thread_current ()->children, &c->list_elem);
+
+  sema_down (&c->started);
+  if (!c->start_success)
+    {
+      forget_child (c);
+      return TID_ERROR;
+    }
+  return c->tid;
+}
+
+/* Lets go of C, a child of the running process, so that it can
+   no longer be waited for. */
+static void
+forget_child (struct child *c)
+{
+  list_remove (&c->list_elem);
+  lock_acquire (&process_lock);
+  hash_delete (&process_table, &c->hash_elem);
+  lock_release (&process_lock);
+  unref_child (c);
+}
+
+/* Drops a reference to C, freeing it once both the process it
+   describes and that process's parent are done with it. */
+static void
+unref_child (struct child *c)
+{
+  bool dead;
+
+  lock_acquire (&process_lock);
+  dead = --c->ref_cnt == 0;
+  lock_release (&process_lock);
+  if (dead)
+    free (c);
+}
+
+/* Returns a hash value for child E. */
+static unsigned
+child_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  return hash_int (hash_entry (e, struct child, hash_elem)->tid);
+}
+
+/* Returns true if child A precedes child B. */
+static bool
+child_less (const struct hash_elem *a, const struct hash_elem *b,
+            void *aux UNUSED)
+{
+  return (hash_entry (a, struct child, hash_elem)->tid
+          < hash_entry (b, struct child, hash_elem)->tid);
+}
+
+/* Prints exec latency statistics. */
+void
+process_print_stats (void) 
+{
+  printf ("Exec: %lld processes started, %lld cycles each to first "
+          "instruction\n", exec_cnt, exec_cnt ? exec_cycles / exec_cnt : 0);
 }
 
 /* We load ELF binaries.  The following definitions are taken
@@ -195,31 +793,54 @@ struct Elf32_Phdr
 #define PF_W 2          /* Writable. */
 #define PF_R 4          /* Readable. */
 
-static bool setup_stack (void **esp);
+static int split_words (char *, size_t *len);
+static bool setup_stack (void **esp, const char *args, size_t args_len,
+                         int argc);
 static bool validate_segment (const struct Elf32_Phdr *, struct file *);
 static bool load_segment (struct file *file, off_t ofs, uint8_t *upage,
                           uint32_t read_bytes, uint32_t zero_bytes,
                           bool writable);
 
-/* Loads an ELF executable from FILE_NAME into the current thread.
+/* Loads the ELF executable named by the first word of CMD_LINE
+   into the current thread, and passes it the words of CMD_LINE
+   as its arguments.  CMD_LINE is modified.
    Stores the executable's entry point into *EIP
    and its initial stack pointer into *ESP.
    Returns true if successful, false otherwise. */
 bool
-load (const char *file_name, void (**eip) (void), void **esp) 
+load (char *cmd_line, void (**eip) (void), void **esp) 
 {
   struct thread *t = thread_current ();
+  const char *file_name = cmd_line;
   struct Elf32_Ehdr ehdr;
   struct file *file = NULL;
   off_t file_ofs;
+  size_t args_len;
   bool success = false;
+  int argc;
   int i;
 
+  /* The file system lock is held throughout, since the
+     executable is read here, and entirely so without virtual
+     memory. */
+  lock_acquire (&fs_lock);
+
+  /* Split the command line into the program name and its
+     arguments. */
+  argc = split_words (cmd_line, &args_len);
+  if (argc == 0)
+    goto done;
+
   /* Allocate and activate page directory. */
   t->pagedir = pagedir_create ();
   if (t->pagedir == NULL) 
     goto done;
   process_activate ();
+#ifdef VM
+  t->pages = page_table_create ();
+  if (t->pages == NULL)
+    goto done;
+#endif
 
   /* Open executable file. */
   file = filesys_open (file_name);
@@ -229,6 +850,11 @@ load (const char *file_name, void (**eip) (void), void **esp)
       goto done; 
     }
 
+  /* Keep the executable from changing under the running
+     process.  Pages of it may be read at any time and shared
+     with other processes. */
+  file_deny_write (file);
+
   /* Read and verify executable header. */
   if (file_read (file, &ehdr, sizeof ehdr) != sizeof ehdr
       || memcmp (ehdr.e_ident, "\177ELF\1\1\1", 7)
@@ -294,6 +920,10 @@ load (const char *file_name, void (**eip) (void), void **esp)
               if (!load_segment (file, file_page, (void *) mem_page,
                                  read_bytes, zero_bytes, writable))
                 goto done;
+              if (mem_page + read_bytes + zero_bytes
+                  > (uintptr_t) t->heap_start)
+                t->heap_start = (uint8_t *) mem_page + read_bytes
+                                + zero_bytes;
             }
           else
             goto done;
@@ -301,8 +931,15 @@ load (const char *file_name, void (**eip) (void), void **esp)
         }
     }
 
+  /* The heap starts out empty, after the last segment. */
+  t->heap_break = t->heap_start;
+
   /* Set up stack. */
-  if (!setup_stack (esp))
+  if (!setup_stack (esp, cmd_line, args_len, argc))
+    goto done;
+
+  /* Map the kernel data page. */
+  if (!kdata_map ())
     goto done;
 
   /* Start address. */
@@ -311,14 +948,19 @@ load (const char *file_name, void (**eip) (void), void **esp)
   success = true;
 
  done:
-  /* We arrive here whether the load is successful or not. */
-  file_close (file);
+  /* We arrive here whether the load is successful or not.  The
+     executable stays open until the process exits, so that its
+     pages can be read on demand. */
+  t->executable = file;
+  lock_release (&fs_lock);
   return success;
 }
 
 /* load() helpers. */
 
 static bool install_page (void *upage, void *kpage, bool writable);
+static void *alloc_user_page (void *upage, bool zero);
+static void free_user_page (void *kpage);
 
 /* Checks whether PHDR describes a valid, loadable segment in
    FILE and returns true if so, false otherwise. */
@@ -377,6 +1019,10 @@ validate_segment (const struct Elf32_Phdr *phdr, struct file *file)
    The pages initialized by this function must be writable by the
    user process if WRITABLE is true, read-only otherwise.
 
+   With virtual memory, the pages are only recorded in the
+   supplemental page table here, and are read when first
+   accessed.
+
    Return true if successful, false if a memory allocation error
    or disk read error occurs. */
 static bool
@@ -396,15 +1042,21 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
       size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
       size_t page_zero_bytes = PGSIZE - page_read_bytes;
 
+#ifdef VM
+      /* Record the page, to be read on first access. */
+      if (!page_add_file (upage, file, ofs, page_read_bytes, writable))
+        return false;
+      ofs += page_read_bytes;
+#else
       /* Get a page of memory. */
-      uint8_t *kpage = palloc_get_page (PAL_USER);
+      uint8_t *kpage = alloc_user_page (upage, false);
       if (kpage == NULL)
         return false;
 
       /* Load this page. */
       if (file_read (file, kpage, page_read_bytes) != (int) page_read_bytes)
         {
-          palloc_free_page (kpage);
+          free_user_page (kpage);
           return false; 
         }
       memset (kpage + page_read_bytes, 0, page_zero_bytes);
@@ -412,9 +1064,10 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
       /* Add the page to the process's address space. */
       if (!install_page (upage, kpage, writable)) 
         {
-          palloc_free_page (kpage);
+          free_user_page (kpage);
           return false; 
         }
+#endif
 
       /* Advance. */
       read_bytes -= page_read_bytes;
@@ -424,24 +1077,85 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
   return true;
 }
 
+/* Splits S into words separated by spaces, and packs them
+   together at the beginning of S, each followed by a null
+   terminator.  Stores the number of bytes they take up into
+   *LEN, and returns the number of words. */
+static int
+split_words (char *s, size_t *len)
+{
+  char *word, *save_ptr;
+  int cnt = 0;
+
+  *len = 0;
+  for (word = strtok_r (s, " ", &save_ptr); word != NULL;
+       word = strtok_r (NULL, " ", &save_ptr))
+    {
+      size_t word_len = strlen (word) + 1;
+
+      /* The word only moves down, and strtok_r() has already
+         looked past it. */
+      memmove (s + *len, word, word_len);
+      *len += word_len;
+      cnt++;
+    }
+  return cnt;
+}
+
 /* Create a minimal stack by mapping a zeroed page at the top of
-   user virtual memory. */
+   user virtual memory, and set it up for the program's entry
+   point, _start(), to be called with ARGC and ARGV.  ARGS holds
+   the ARGC arguments, packed one after another with their null
+   terminators, ARGS_LEN bytes in all.
+
+   From the top of the page down, the stack holds the argument
+   strings, then the argv array, aligned on a word boundary and
+   ending in a null pointer, then argv, argc, and a null return
+   address.  Fails if they do not fit in the page. */
 static bool
-setup_stack (void **esp) 
+setup_stack (void **esp, const char *args, size_t args_len, int argc)
 {
+  uint8_t *upage = ((uint8_t *) PHYS_BASE) - PGSIZE;
   uint8_t *kpage;
-  bool success = false;
+  size_t args_ofs, argv_ofs, word_ofs;
+  char **argv;
+  uint32_t *sp;
+  int i;
+
+  if (ROUND_UP (args_len, sizeof (char *)) + (argc + 1) * sizeof (char *)
+      + 3 * sizeof (uint32_t) > PGSIZE)
+    return false;
 
-  kpage = palloc_get_page (PAL_USER | PAL_ZERO);
-  if (kpage != NULL) 
+  kpage = alloc_user_page (upage, true);
+  if (kpage == NULL)
+    return false;
+
+  /* Fill in the page through its kernel address, before it is
+     installed, since with virtual memory it may be evicted as
+     soon as it is. */
+  args_ofs = PGSIZE - args_len;
+  memcpy (kpage + args_ofs, args, args_len);
+  argv_ofs = (ROUND_DOWN (args_ofs, sizeof (char *))
+              - (argc + 1) * sizeof (char *));
+  argv = (char **) (kpage + argv_ofs);
+  for (i = 0, word_ofs = 0; i < argc; i++)
     {
-      success = install_page (((uint8_t *) PHYS_BASE) - PGSIZE, kpage, true);
-      if (success)
-        *esp = PHYS_BASE;
-      else
-        palloc_free_page (kpage);
+      argv[i] = (char *) upage + args_ofs + word_ofs;
+      word_ofs += strlen (args + word_ofs) + 1;
     }
-  return success;
+  argv[argc] = NULL;
+  sp = (uint32_t *) argv - 3;
+  sp[0] = 0;
+  sp[1] = argc;
+  sp[2] = (uint32_t) (upage + argv_ofs);
+
+  if (!install_page (upage, kpage, true))
+    {
+      free_user_page (kpage);
+      return false;
+    }
+  *esp = upage + ((uint8_t *) sp - kpage);
+  return true;
 }
 
 /* Adds a mapping from user virtual address UPAGE to kernel
@@ -449,8 +1163,7 @@ setup_stack (void **esp)
    If WRITABLE is true, the user process may modify the page;
    otherwise, it is read-only.
    UPAGE must not already be mapped.
-   KPAGE should probably be a page obtained from the user pool
-   with palloc_get_page().
+   KPAGE should be a page obtained with alloc_user_page().
    Returns true on success, false if UPAGE is already mapped or
    if memory allocation fails. */
 static bool
@@ -460,6 +1173,121 @@ install_page (void *upage, void *kpage, bool writable)
 
   /* Verify that there's not already a page at that virtual
      address, then map our page there. */
-  return (pagedir_get_page (t->pagedir, upage) == NULL
-          && pagedir_set_page (t->pagedir, upage, kpage, writable));
+  if (pagedir_get_page (t->pagedir, upage) != NULL
+      || !pagedir_set_page (t->pagedir, upage, kpage, writable))
+    return false;
+
+#ifdef VM
+  /* Now that the page is mapped, it may be evicted. */
+  frame_unpin (kpage);
+#endif
+  return true;
+}
+
+/* Obtains a page from the user pool to hold user virtual page
+   UPAGE of the running process, zeroed if ZERO is true, and
+   returns its kernel virtual address.  With virtual memory,
+   another process's page may be evicted to make room.  Returns
+   a null pointer if no page is available. */
+static void *
+alloc_user_page (void *upage UNUSED, bool zero)
+{
+  enum palloc_flags flags = zero ? PAL_ZERO : 0;
+#ifdef VM
+  return frame_alloc (flags, upage);
+#else
+  return palloc_get_page (PAL_USER | flags);
+#endif
+}
+
+/* Frees KPAGE, which was obtained with alloc_user_page() but
+   never installed with install_page(). */
+static void
+free_user_page (void *kpage)
+{
+#ifdef VM
+  frame_free (kpage);
+#else
+  palloc_free_page (kpage);
+#endif
+}
+
+static bool add_heap_page (void *upage);
+static void remove_heap_page (void *upage);
+
+/* Moves the running process's break, the end of its heap, by
+   INCREMENT bytes, and returns the old break.  The heap begins
+   at the page boundary after the executable's last segment and
+   is empty when the process starts.  Pages added to it read as
+   zeros; with virtual memory, they take no frame until they are
+   written.  Pages that shrinking the heap leaves entirely past
+   the break are freed.
+
+   Returns a null pointer, leaving the break unchanged, if the
+   heap would end before its start or run into another part of
+   the address space, or if memory allocation fails. */
+void *
+process_sbrk (int increment)
+{
+  struct thread *t = thread_current ();
+  uintptr_t old_break = (uintptr_t) t->heap_break;
+  uintptr_t new_break = old_break + increment;
+  uint8_t *old_end = pg_round_up (t->heap_break);
+  uint8_t *new_end, *upage;
+
+  if (increment < 0
+      ? new_break > old_break || new_break < (uintptr_t) t->heap_start
+      : new_break < old_break || new_break > (uintptr_t) PHYS_BASE)
+    return NULL;
+  new_end = pg_round_up ((void *) new_break);
+
+  for (upage = old_end; upage < new_end; upage += PGSIZE)
+    if (!add_heap_page (upage))
+      {
+        while (upage > old_end)
+          remove_heap_page (upage -= PGSIZE);
+        return NULL;
+      }
+  for (upage = new_end; upage < old_end; upage += PGSIZE)
+    remove_heap_page (upage);
+
+  t->heap_break = (uint8_t *) new_break;
+  return (void *) old_break;
+}
+
+/* Adds UPAGE, which must be unused, to the running process's
+   heap.  Returns true if successful, false if UPAGE is in use
+   or memory allocation fails. */
+static bool
+add_heap_page (void *upage)
+{
+#ifdef VM
+  return !page_in_use (upage) && page_add_zero (upage);
+#else
+  uint8_t *kpage = alloc_user_page (upage, true);
+  if (kpage == NULL)
+    return false;
+  if (!install_page (upage, kpage, true))
+    {
+      free_user_page (kpage);
+      return false;
+    }
+  return true;
+#endif
+}
+
+/* Removes UPAGE, added with add_heap_page(), from the running
+   process's heap and frees it. */
+static void
+remove_heap_page (void *upage)
+{
+#ifdef VM
+  page_remove (upage);
+#else
+  uint32_t *pd = thread_current ()->pagedir;
+  void *kpage = pagedir_get_page (pd, upage);
+
+  pagedir_clear_page (pd, upage);
+  palloc_free_page (kpage);
+#endif
 }
@@ -1,11 +1,30 @@
 #ifndef USERPROG_PROCESS_H
 #define USERPROG_PROCESS_H
 
+#include "threads/interrupt.h"
 #include "threads/thread.h"
 
+struct file;
+struct fd_table;
+
+#ifdef VM
+extern bool process_vm_report;
+#endif
+
+void process_init (void);
 tid_t process_execute (const char *file_name);
+tid_t process_fork (const struct intr_frame *);
 int process_wait (tid_t);
 void process_exit (void);
 void process_activate (void);
+void process_print_stats (void);
+
+int process_add_file (struct file *);
+struct file *process_get_file (int handle);
+bool process_close_file (int handle);
+int process_dup_file (int handle);
+int process_dup2_file (int handle, int new_handle);
+struct fd_table *process_file_table (void);
+void *process_sbrk (int increment);
 
 #endif /* userprog/process.h */
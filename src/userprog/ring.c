@@ -0,0 +1,322 @@
+#include "userprog/ring.h"
+#include <debug.h>
+#include <ring.h>
+#include <round.h>
+#include <string.h>
+#include "userprog/pagedir.h"
+#include "userprog/process.h"
+#include "userprog/syscall.h"
+#include "filesys/file.h"
+#include "filesys/filesys.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#ifdef VM
+#include "vm/page.h"
+#endif
+
+/* Submission and completion rings (see lib/ring.h).
+
+   A process that sets up rings gets a worker thread of its own,
+   which shares the process's file descriptor table, much as a
+   second thread in the process would.  The two take the file
+   system lock around every use of the table and its files, so
+   the process may keep making system calls while the worker
+   runs.
+
+   The worker sleeps until ring_enter() wakes it, then executes
+   submissions in batches, posting each completion as it goes,
+   until the submission queue is empty or the completion queue
+   full.  A process waiting in ring_enter() for completions is
+   woken at the end of each batch.
+
+   The worker reaches the shared pages through their kernel
+   addresses, since it does not run in the process's address
+   space.  For the same reason, buffers must lie in the ring
+   area rather than anywhere in user memory. */
+
+/* A process's rings. */
+struct ring
+  {
+    struct ring_area *area;     /* Shared pages, at kernel address. */
+    struct fd_table *fds;       /* Owner's file descriptor table. */
+    struct lock lock;           /* Protects the members below. */
+    struct condition submitted; /* Signaled when work may be due. */
+    struct condition completed; /* Signaled after each batch. */
+    bool dying;                 /* Owner exiting? */
+    struct semaphore exited;    /* Upped when the worker is done. */
+  };
+
+/* Pages in a struct ring_area. */
+#define RING_PAGES DIV_ROUND_UP (sizeof (struct ring_area), PGSIZE)
+
+static thread_func ring_worker;
+static bool pending (const struct ring *);
+static void run_batch (struct ring *);
+static int execute (struct ring *, const struct ring_sqe *);
+static bool buffer_ok (const struct ring_sqe *);
+static void unmap_area (uint8_t *upage, size_t page_cnt);
+
+/* Maps a struct ring_area at user address ADDR, which must be
+   page-aligned and clear of every page in use, and starts a
+   worker to execute the running process's submissions.  Returns
+   true if successful, false if ADDR is unsuitable, if the
+   process already has rings, or if memory allocation fails.
+
+   The pages become part of the process's address space, which
+   frees them when the process exits.  They are not inherited by
+   fork(). */
+bool
+ring_setup (void *addr)
+{
+  struct thread *cur = thread_current ();
+  uint8_t *upage = addr;
+  struct ring *r;
+  size_t i;
+
+  if (cur->ring != NULL || upage == NULL || pg_ofs (upage) != 0)
+    return false;
+  for (i = 0; i < RING_PAGES; i++)
+    {
+      uint8_t *page = upage + i * PGSIZE;
+#ifdef VM
+      if (!is_user_vaddr (page) || page_in_use (page))
+        return false;
+#else
+      if (!is_user_vaddr (page)
+          || pagedir_get_page (cur->pagedir, page) != NULL)
+        return false;
+#endif
+    }
+
+  r = malloc (sizeof *r);
+  if (r == NULL)
+    return false;
+  r->fds = process_file_table ();
+  r->area = palloc_get_multiple (PAL_USER | PAL_ZERO, RING_PAGES);
+  if (r->fds == NULL || r->area == NULL)
+    {
+      palloc_free_multiple (r->area, RING_PAGES);
+      free (r);
+      return false;
+    }
+  for (i = 0; i < RING_PAGES; i++)
+    if (!pagedir_set_page (cur->pagedir, upage + i * PGSIZE,
+                           (uint8_t *) r->area + i * PGSIZE, true))
+      {
+        unmap_area (upage, i);
+        palloc_free_multiple (r->area, RING_PAGES);
+        free (r);
+        return false;
+      }
+
+  lock_init (&r->lock);
+  cond_init (&r->submitted);
+  cond_init (&r->completed);
+  r->dying = false;
+  sema_init (&r->exited, 0);
+  if (thread_create ("ring", thread_get_priority (), ring_worker, r)
+      == TID_ERROR)
+    {
+      unmap_area (upage, RING_PAGES);
+      palloc_free_multiple (r->area, RING_PAGES);
+      free (r);
+      return false;
+    }
+  cur->ring = r;
+  return true;
+}
+
+/* Wakes the running process's worker to execute its pending
+   submissions and waits until at least MIN_COMPLETE completions
+   are ready to be reaped, or until the worker runs out of work.
+   Returns the number of completions ready, or -1 if the process
+   has no rings. */
+int
+ring_enter (unsigned min_complete)
+{
+  struct ring *r = thread_current ()->ring;
+  unsigned ready;
+
+  if (r == NULL)
+    return -1;
+  if (min_complete > RING_ENTRIES)
+    min_complete = RING_ENTRIES;
+
+  lock_acquire (&r->lock);
+  cond_signal (&r->submitted, &r->lock);
+  while ((ready = r->area->cq_tail - r->area->cq_head) < min_complete
+         && pending (r))
+    cond_wait (&r->completed, &r->lock);
+  lock_release (&r->lock);
+  return ready;
+}
+
+/* Stops the running process's worker, if it has one, and frees
+   its rings.  Must be called before the process closes its files
+   or destroys its address space. */
+void
+ring_exit (void)
+{
+  struct thread *cur = thread_current ();
+  struct ring *r = cur->ring;
+
+  if (r == NULL)
+    return;
+  lock_acquire (&r->lock);
+  r->dying = true;
+  cond_signal (&r->submitted, &r->lock);
+  lock_release (&r->lock);
+  sema_down (&r->exited);
+
+  free (r);
+  cur->ring = NULL;
+}
+
+/* A ring's worker thread. */
+static void
+ring_worker (void *r_)
+{
+  struct ring *r = r_;
+
+  thread_current ()->fds = r->fds;
+  lock_acquire (&r->lock);
+  for (;;)
+    {
+      while (!r->dying && !pending (r))
+        cond_wait (&r->submitted, &r->lock);
+      if (r->dying)
+        break;
+      lock_release (&r->lock);
+      run_batch (r);
+      lock_acquire (&r->lock);
+      cond_broadcast (&r->completed, &r->lock);
+    }
+  lock_release (&r->lock);
+
+  /* The table is the owner's to free. */
+  thread_current ()->fds = NULL;
+  sema_up (&r->exited);
+}
+
+/* Returns true if R has a submission to execute and room to post
+   its completion. */
+static bool
+pending (const struct ring *r)
+{
+  const struct ring_area *a = r->area;
+
+  return a->sq_head != a->sq_tail && a->cq_tail - a->cq_head < RING_ENTRIES;
+}
+
+/* Executes R's pending submissions, at most a queue's worth,
+   posting a completion for each. */
+static void
+run_batch (struct ring *r)
+{
+  struct ring_area *a = r->area;
+  unsigned cnt;
+
+  for (cnt = 0; cnt < RING_ENTRIES && !r->dying && pending (r); cnt++)
+    {
+      unsigned head = a->sq_head;
+      unsigned tail = a->cq_tail;
+      struct ring_sqe sqe;
+      int result;
+
+      /* Copy the entry, which the process may be changing. */
+      sqe = a->sq[head % RING_ENTRIES];
+      lock_acquire (&fs_lock);
+      result = execute (r, &sqe);
+      lock_release (&fs_lock);
+
+      a->cq[tail % RING_ENTRIES].user_data = sqe.user_data;
+      a->cq[tail % RING_ENTRIES].result = result;
+      barrier ();
+      a->cq_tail = tail + 1;
+      a->sq_head = head + 1;
+    }
+}
+
+/* Carries out SQE for R's owner and returns its result, or -1 if
+   SQE is invalid.  The caller must hold the file system lock. */
+static int
+execute (struct ring *r, const struct ring_sqe *sqe)
+{
+  uint8_t *buf = r->area->buf;
+  struct file *file;
+  int handle;
+  off_t pos;
+  off_t n;
+
+  if (sqe->op != RING_NOP && sqe->op != RING_CLOSE)
+    {
+      if (!buffer_ok (sqe))
+        return -1;
+      buf += sqe->buf;
+    }
+
+  switch (sqe->op)
+    {
+    case RING_NOP:
+      return 0;
+
+    case RING_OPEN:
+      {
+        char *name = malloc (sqe->len + 1);
+        if (name == NULL)
+          return -1;
+        memcpy (name, buf, sqe->len);
+        name[sqe->len] = '\0';
+        file = filesys_open (name);
+        free (name);
+        if (file == NULL)
+          return -1;
+        handle = process_add_file (file);
+        if (handle == -1)
+          file_close (file);
+        return handle;
+      }
+
+    case RING_CLOSE:
+      return process_close_file (sqe->fd) ? 0 : -1;
+
+    case RING_READ:
+    case RING_WRITE:
+      file = process_get_file (sqe->fd);
+      if (file == NULL)
+        return -1;
+      pos = sqe->pos >= 0 ? sqe->pos : file_tell (file);
+      if (sqe->op == RING_READ)
+        n = file_read_at (file, buf, sqe->len, pos);
+      else
+        n = file_write_at (file, buf, sqe->len, pos);
+      if (sqe->pos < 0)
+        file_seek (file, pos + n);
+      return n;
+
+    default:
+      return -1;
+    }
+}
+
+/* Returns true if SQE's data lies within the ring's buffer. */
+static bool
+buffer_ok (const struct ring_sqe *sqe)
+{
+  return sqe->buf <= RING_BUF_SIZE && sqe->len <= RING_BUF_SIZE - sqe->buf;
+}
+
+/* Removes the mappings of the PAGE_CNT pages starting at UPAGE
+   from the running process's page directory. */
+static void
+unmap_area (uint8_t *upage, size_t page_cnt)
+{
+  uint32_t *pd = thread_current ()->pagedir;
+  size_t i;
+
+  for (i = 0; i < page_cnt; i++)
+    pagedir_clear_page (pd, upage + i * PGSIZE);
+}
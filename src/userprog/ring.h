@@ -0,0 +1,10 @@
+#ifndef USERPROG_RING_H
+#define USERPROG_RING_H
+
+#include <stdbool.h>
+
+bool ring_setup (void *addr);
+int ring_enter (unsigned min_complete);
+void ring_exit (void);
+
+#endif /* userprog/ring.h */
@@ -1,20 +1,693 @@
 #include "userprog/syscall.h"
+#include <console.h>
+#include <iovec.h>
 #include <stdio.h>
 #include <syscall-nr.h>
+#include "userprog/process.h"
+#include "userprog/ring.h"
+#include "userprog/trace.h"
+#include "userprog/usermem.h"
+#include "devices/input.h"
+#include "devices/shutdown.h"
+#include "filesys/file.h"
+#include "filesys/filesys.h"
 #include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
+#include "threads/vaddr.h"
+#ifdef VM
+#include "vm/mmap.h"
+#endif
 
-static void syscall_handler (struct intr_frame *);
+/* A system call handler.  ARGS holds the call's arguments, as
+   copied from the user stack, and F the user's registers.
+   Returns the value for the user's EAX. */
+typedef int syscall_function (const int args[], struct intr_frame *f);
+
+/* A system call. */
+struct syscall
+  {
+    size_t arg_cnt;             /* Number of arguments. */
+    syscall_function *func;     /* Implementation. */
+  };
+
+/* Most arguments any system call takes. */
+#define SYSCALL_MAX_ARGS 4
+
+static syscall_function sys_halt, sys_exit, sys_exec, sys_wait;
+static syscall_function sys_create, sys_remove, sys_open, sys_filesize;
+static syscall_function sys_read, sys_write, sys_seek, sys_tell;
+static syscall_function sys_close, sys_fork, sys_dup, sys_dup2;
+static syscall_function sys_readv, sys_writev, sys_pread, sys_pwrite;
+static syscall_function sys_copy_file, sys_ring_setup, sys_ring_enter;
+static syscall_function sys_trace, sys_sbrk;
+#ifdef VM
+static syscall_function sys_mmap, sys_munmap, sys_vm_usage;
+#endif
+
+/* System calls, indexed by number.  A process that makes a
+   system call not in the table is terminated. */
+static const struct syscall syscall_table[] =
+  {
+    [SYS_HALT] = {0, sys_halt},
+    [SYS_EXIT] = {1, sys_exit},
+    [SYS_EXEC] = {1, sys_exec},
+    [SYS_WAIT] = {1, sys_wait},
+    [SYS_CREATE] = {2, sys_create},
+    [SYS_REMOVE] = {1, sys_remove},
+    [SYS_OPEN] = {1, sys_open},
+    [SYS_FILESIZE] = {1, sys_filesize},
+    [SYS_READ] = {3, sys_read},
+    [SYS_WRITE] = {3, sys_write},
+    [SYS_SEEK] = {2, sys_seek},
+    [SYS_TELL] = {1, sys_tell},
+    [SYS_CLOSE] = {1, sys_close},
+#ifdef VM
+    [SYS_MMAP] = {2, sys_mmap},
+    [SYS_MUNMAP] = {1, sys_munmap},
+    [SYS_VM_USAGE] = {1, sys_vm_usage},
+#endif
+    [SYS_FORK] = {0, sys_fork},
+    [SYS_DUP] = {1, sys_dup},
+    [SYS_DUP2] = {2, sys_dup2},
+    [SYS_READV] = {3, sys_readv},
+    [SYS_WRITEV] = {3, sys_writev},
+    [SYS_PREAD] = {4, sys_pread},
+    [SYS_PWRITE] = {4, sys_pwrite},
+    [SYS_COPY_FILE] = {4, sys_copy_file},
+    [SYS_RING_SETUP] = {1, sys_ring_setup},
+    [SYS_RING_ENTER] = {1, sys_ring_enter},
+    [SYS_TRACE] = {1, sys_trace},
+    [SYS_SBRK] = {1, sys_sbrk},
+  };
+
+/* Number of entries in syscall_table. */
+#define SYSCALL_CNT (sizeof syscall_table / sizeof *syscall_table)
+
+/* Serializes file system operations. */
+struct lock fs_lock;
+
+static void copy_in (void *dst, const void *usrc, size_t size);
+static char *copy_in_string (const char *us);
 
 void
-syscall_init (void) 
+syscall_init (void)
 {
   intr_register_int (0x30, 3, INTR_ON, syscall_handler, "syscall");
+  lock_init (&fs_lock);
 }
 
+/* System call handler.  Called for int $0x30 through the
+   interrupt machinery and for SYSENTER by sysenter_entry(), with
+   the same frame either way. */
+void
+syscall_handler (struct intr_frame *f)
+{
+  const int *esp = f->esp;
+  const struct syscall *sc;
+  int args[SYSCALL_MAX_ARGS];
+  unsigned nr;
+
+  /* The system call number is on top of the user stack, followed
+     by the arguments. */
+  copy_in (&nr, esp, sizeof nr);
+  if (nr >= SYSCALL_CNT || syscall_table[nr].func == NULL)
+    thread_exit ();
+  sc = &syscall_table[nr];
+
+  ASSERT (sc->arg_cnt <= SYSCALL_MAX_ARGS);
+  copy_in (args, esp + 1, sc->arg_cnt * sizeof *args);
+  if (thread_current ()->trace == NULL)
+    f->eax = sc->func (args, f);
+  else
+    {
+      unsigned seq = trace_enter (nr, args, sc->arg_cnt);
+      f->eax = sc->func (args, f);
+      trace_leave (seq, f->eax);
+    }
+}
+
+/* Halt system call. */
+static int
+sys_halt (const int args[] UNUSED, struct intr_frame *f UNUSED)
+{
+  shutdown_power_off ();
+}
+
+/* Exit system call. */
+static int
+sys_exit (const int args[], struct intr_frame *f UNUSED)
+{
+  thread_current ()->exit_code = args[0];
+  thread_exit ();
+}
+
+/* Exec system call. */
+static int
+sys_exec (const int args[], struct intr_frame *f UNUSED)
+{
+  char *kcmd = copy_in_string ((const char *) args[0]);
+  tid_t tid = process_execute (kcmd);
+  palloc_free_page (kcmd);
+  return tid;
+}
+
+/* Wait system call. */
+static int
+sys_wait (const int args[], struct intr_frame *f UNUSED)
+{
+  return process_wait (args[0]);
+}
+
+/* Create system call. */
+static int
+sys_create (const int args[], struct intr_frame *f UNUSED)
+{
+  char *kfile = copy_in_string ((const char *) args[0]);
+  bool ok;
+
+  lock_acquire (&fs_lock);
+  ok = filesys_create (kfile, args[1]);
+  lock_release (&fs_lock);
+  palloc_free_page (kfile);
+  return ok;
+}
+
+/* Remove system call. */
+static int
+sys_remove (const int args[], struct intr_frame *f UNUSED)
+{
+  char *kfile = copy_in_string ((const char *) args[0]);
+  bool ok;
+
+  lock_acquire (&fs_lock);
+  ok = filesys_remove (kfile);
+  lock_release (&fs_lock);
+  palloc_free_page (kfile);
+  return ok;
+}
+
+/* Open system call. */
+static int
+sys_open (const int args[], struct intr_frame *f UNUSED)
+{
+  char *kfile = copy_in_string ((const char *) args[0]);
+  struct file *file;
+  int handle = -1;
+
+  lock_acquire (&fs_lock);
+  file = filesys_open (kfile);
+  if (file != NULL)
+    {
+      handle = process_add_file (file);
+      if (handle == -1)
+        file_close (file);
+    }
+  lock_release (&fs_lock);
+  palloc_free_page (kfile);
+  return handle;
+}
+
+/* Filesize system call. */
+static int
+sys_filesize (const int args[], struct intr_frame *f UNUSED)
+{
+  struct file *file;
+  int size = -1;
+
+  lock_acquire (&fs_lock);
+  file = process_get_file (args[0]);
+  if (file != NULL)
+    size = file_length (file);
+  lock_release (&fs_lock);
+  return size;
+}
+
+/* A read or write in progress, on behalf of a read, write,
+   readv, writev, pread, or pwrite system call.
+
+   File data goes through a kernel page, so that no user page
+   faults while the file system holds its locks, and reaches the
+   user buffer with copy_to_user() or leaves it with
+   copy_from_user(), which leave checking the buffer to the MMU:
+   a bad buffer costs a fault, a good one nothing extra.  Files
+   are always accessed at an explicit offset, which the calls
+   that use the file position take from it and store back.  The
+   transfer holds a reference to the file, so that the process's
+   ring worker cannot free it by closing the handle meanwhile. */
+struct io
+  {
+    struct file *file;          /* File, or null for the console. */
+    off_t pos;                  /* Offset in FILE. */
+    bool positional;            /* Leave FILE's position alone? */
+    uint8_t *kbuf;              /* Kernel bounce page. */
+  };
+
+static void io_end (struct io *);
+
+/* Prepares IO for reading from HANDLE, if WRITE is false, or for
+   writing to it, if WRITE is true.  If POS is nonnull, the
+   transfer starts at offset *POS and does not use or change the
+   file position; this requires HANDLE to be a file.  Returns
+   true if successful, false if HANDLE is not open for the
+   transfer or no memory is available. */
+static bool
+io_begin (struct io *io, int handle, bool write, const off_t *pos)
+{
+  io->file = NULL;
+  io->kbuf = NULL;
+  io->positional = pos != NULL;
+  if (io->positional && *pos < 0)
+    return false;
+  if (handle != (write ? STDOUT_FILENO : STDIN_FILENO) || pos != NULL)
+    {
+      lock_acquire (&fs_lock);
+      io->file = process_get_file (handle);
+      if (io->file != NULL)
+        {
+          io->file = file_dup (io->file);
+          io->pos = io->positional ? *pos : file_tell (io->file);
+        }
+      lock_release (&fs_lock);
+      if (io->file == NULL)
+        return false;
+    }
+
+  if (io->file != NULL || write)
+    {
+      io->kbuf = palloc_get_page (0);
+      if (io->kbuf == NULL)
+        {
+          io_end (io);
+          return false;
+        }
+    }
+  return true;
+}
+
+/* Finishes IO, storing its offset back as the file position
+   unless it was positional. */
 static void
-syscall_handler (struct intr_frame *f UNUSED) 
+io_end (struct io *io)
 {
-  printf ("system call!\n");
+  if (io->file != NULL)
+    {
+      lock_acquire (&fs_lock);
+      if (!io->positional)
+        file_seek (io->file, io->pos);
+      file_close (io->file);
+      lock_release (&fs_lock);
+    }
+  palloc_free_page (io->kbuf);
+}
+
+/* Frees IO and terminates the process, whose buffer was bad. */
+static void NO_RETURN
+io_fail (struct io *io)
+{
+  io_end (io);
   thread_exit ();
 }
+
+/* Reads up to SIZE bytes for IO into user buffer UBUF.  Returns
+   the number of bytes read, which is less than SIZE only at end
+   of file. */
+static unsigned
+io_read (struct io *io, uint8_t *ubuf, unsigned size)
+{
+  unsigned total = 0;
+
+  if (io->file == NULL)
+    {
+      for (; total < size; total++)
+        if (!put_user (ubuf + total, input_getc ()))
+          io_fail (io);
+      return total;
+    }
+
+  while (total < size)
+    {
+      off_t chunk = size - total < PGSIZE ? size - total : PGSIZE;
+      off_t n;
+
+      lock_acquire (&fs_lock);
+      n = file_read_at (io->file, io->kbuf, chunk, io->pos);
+      lock_release (&fs_lock);
+      if (!copy_to_user (ubuf + total, io->kbuf, n))
+        io_fail (io);
+      io->pos += n;
+      total += n;
+      if (n < chunk)
+        break;
+    }
+  return total;
+}
+
+/* Writes up to SIZE bytes for IO from user buffer UBUF.  Returns
+   the number of bytes written, which is less than SIZE only at
+   end of file. */
+static unsigned
+io_write (struct io *io, const uint8_t *ubuf, unsigned size)
+{
+  unsigned total = 0;
+
+  while (total < size)
+    {
+      off_t chunk = size - total < PGSIZE ? size - total : PGSIZE;
+      off_t n = chunk;
+
+      if (!copy_from_user (io->kbuf, ubuf + total, chunk))
+        io_fail (io);
+      if (io->file == NULL)
+        putbuf ((const char *) io->kbuf, chunk);
+      else
+        {
+          lock_acquire (&fs_lock);
+          n = file_write_at (io->file, io->kbuf, chunk, io->pos);
+          lock_release (&fs_lock);
+          io->pos += n;
+        }
+      total += n;
+      if (n < chunk)
+        break;
+    }
+  return total;
+}
+
+/* Read system call. */
+static int
+sys_read (const int args[], struct intr_frame *f UNUSED)
+{
+  struct io io;
+  int n;
+
+  if (!io_begin (&io, args[0], false, NULL))
+    return -1;
+  n = io_read (&io, (uint8_t *) args[1], args[2]);
+  io_end (&io);
+  return n;
+}
+
+/* Write system call. */
+static int
+sys_write (const int args[], struct intr_frame *f UNUSED)
+{
+  struct io io;
+  int n;
+
+  if (!io_begin (&io, args[0], true, NULL))
+    return -1;
+  n = io_write (&io, (const uint8_t *) args[1], args[2]);
+  io_end (&io);
+  return n;
+}
+
+/* Copies the array of CNT iovecs at user address UIOV into IOV,
+   which has room for IOV_MAX.  Returns false if CNT is out of
+   range.  Terminates the process if the array cannot be read. */
+static bool
+copy_in_iovecs (struct iovec iov[IOV_MAX], const struct iovec *uiov,
+                int cnt)
+{
+  if (cnt < 0 || cnt > IOV_MAX)
+    return false;
+  copy_in (iov, uiov, cnt * sizeof *iov);
+  return true;
+}
+
+/* Readv system call.  Fills each buffer in turn, stopping early
+   only at end of file. */
+static int
+sys_readv (const int args[], struct intr_frame *f UNUSED)
+{
+  struct iovec iov[IOV_MAX];
+  int cnt = args[2];
+  unsigned total = 0;
+  struct io io;
+  int i;
+
+  if (!copy_in_iovecs (iov, (const struct iovec *) args[1], cnt)
+      || !io_begin (&io, args[0], false, NULL))
+    return -1;
+  for (i = 0; i < cnt; i++)
+    {
+      unsigned n = io_read (&io, iov[i].iov_base, iov[i].iov_len);
+      total += n;
+      if (n < iov[i].iov_len)
+        break;
+    }
+  io_end (&io);
+  return total;
+}
+
+/* Writev system call.  Writes each buffer in turn, stopping
+   early only at end of file. */
+static int
+sys_writev (const int args[], struct intr_frame *f UNUSED)
+{
+  struct iovec iov[IOV_MAX];
+  int cnt = args[2];
+  unsigned total = 0;
+  struct io io;
+  int i;
+
+  if (!copy_in_iovecs (iov, (const struct iovec *) args[1], cnt)
+      || !io_begin (&io, args[0], true, NULL))
+    return -1;
+  for (i = 0; i < cnt; i++)
+    {
+      unsigned n = io_write (&io, iov[i].iov_base, iov[i].iov_len);
+      total += n;
+      if (n < iov[i].iov_len)
+        break;
+    }
+  io_end (&io);
+  return total;
+}
+
+/* Pread system call. */
+static int
+sys_pread (const int args[], struct intr_frame *f UNUSED)
+{
+  off_t pos = args[3];
+  struct io io;
+  int n;
+
+  if (!io_begin (&io, args[0], false, &pos))
+    return -1;
+  n = io_read (&io, (uint8_t *) args[1], args[2]);
+  io_end (&io);
+  return n;
+}
+
+/* Pwrite system call. */
+static int
+sys_pwrite (const int args[], struct intr_frame *f UNUSED)
+{
+  off_t pos = args[3];
+  struct io io;
+  int n;
+
+  if (!io_begin (&io, args[0], true, &pos))
+    return -1;
+  n = io_write (&io, (const uint8_t *) args[1], args[2]);
+  io_end (&io);
+  return n;
+}
+
+/* Copy_file system call.  Copies bytes from the input file,
+   starting at the given offset, to the output file at its
+   position, which advances; the input file's position does not
+   change.  The data never leaves the kernel. */
+static int
+sys_copy_file (const int args[], struct intr_frame *f UNUSED)
+{
+  struct file *in, *out;
+  off_t offset = args[2];
+  off_t size = args[3];
+  off_t n = -1;
+
+  if (offset < 0 || size < 0)
+    return -1;
+  lock_acquire (&fs_lock);
+  in = process_get_file (args[0]);
+  out = process_get_file (args[1]);
+  if (in != NULL && out != NULL)
+    {
+      n = file_copy_at (in, offset, out, file_tell (out), size);
+      file_seek (out, file_tell (out) + n);
+    }
+  lock_release (&fs_lock);
+  return n;
+}
+
+/* Ring_setup system call. */
+static int
+sys_ring_setup (const int args[], struct intr_frame *f UNUSED)
+{
+  return ring_setup ((void *) args[0]);
+}
+
+/* Ring_enter system call. */
+static int
+sys_ring_enter (const int args[], struct intr_frame *f UNUSED)
+{
+  return ring_enter (args[0]);
+}
+
+/* Trace system call.  Starts tracing the process's system calls
+   if the argument is true, otherwise stops and prints the
+   trace. */
+static int
+sys_trace (const int args[], struct intr_frame *f UNUSED)
+{
+  if (args[0])
+    return trace_start ();
+  trace_stop ();
+  return true;
+}
+
+/* Sbrk system call. */
+static int
+sys_sbrk (const int args[], struct intr_frame *f UNUSED)
+{
+  void *old_break = process_sbrk (args[0]);
+  return old_break != NULL ? (int) old_break : -1;
+}
+
+/* Seek system call. */
+static int
+sys_seek (const int args[], struct intr_frame *f UNUSED)
+{
+  struct file *file;
+
+  lock_acquire (&fs_lock);
+  file = process_get_file (args[0]);
+  if (file != NULL)
+    file_seek (file, (unsigned) args[1]);
+  lock_release (&fs_lock);
+  return 0;
+}
+
+/* Tell system call. */
+static int
+sys_tell (const int args[], struct intr_frame *f UNUSED)
+{
+  struct file *file;
+  int position = -1;
+
+  lock_acquire (&fs_lock);
+  file = process_get_file (args[0]);
+  if (file != NULL)
+    position = file_tell (file);
+  lock_release (&fs_lock);
+  return position;
+}
+
+/* Close system call. */
+static int
+sys_close (const int args[], struct intr_frame *f UNUSED)
+{
+  lock_acquire (&fs_lock);
+  process_close_file (args[0]);
+  lock_release (&fs_lock);
+  return 0;
+}
+
+/* Fork system call. */
+static int
+sys_fork (const int args[] UNUSED, struct intr_frame *f)
+{
+  return process_fork (f);
+}
+
+/* Dup system call. */
+static int
+sys_dup (const int args[], struct intr_frame *f UNUSED)
+{
+  int handle;
+
+  lock_acquire (&fs_lock);
+  handle = process_dup_file (args[0]);
+  lock_release (&fs_lock);
+  return handle;
+}
+
+/* Dup2 system call. */
+static int
+sys_dup2 (const int args[], struct intr_frame *f UNUSED)
+{
+  int handle;
+
+  lock_acquire (&fs_lock);
+  handle = process_dup2_file (args[0], args[1]);
+  lock_release (&fs_lock);
+  return handle;
+}
+
+#ifdef VM
+/* Mmap system call. */
+static int
+sys_mmap (const int args[], struct intr_frame *f UNUSED)
+{
+  struct file *file;
+  mapid_t mapping = MAPID_ERROR;
+
+  lock_acquire (&fs_lock);
+  file = process_get_file (args[0]);
+  if (file != NULL)
+    mapping = mmap_map (file, (void *) args[1]);
+  lock_release (&fs_lock);
+  return mapping;
+}
+
+/* Munmap system call. */
+static int
+sys_munmap (const int args[], struct intr_frame *f UNUSED)
+{
+  lock_acquire (&fs_lock);
+  mmap_unmap (args[0]);
+  lock_release (&fs_lock);
+  return 0;
+}
+
+/* Vm_usage system call. */
+static int
+sys_vm_usage (const int args[], struct intr_frame *f UNUSED)
+{
+  if (!copy_to_user ((void *) args[0], &thread_current ()->vm_usage,
+                     sizeof (struct vm_usage)))
+    thread_exit ();
+  return 0;
+}
+#endif
+
+/* Copies SIZE bytes from user address USRC to kernel address
+   DST.  Terminates the process if any of the bytes cannot be
+   read. */
+static void
+copy_in (void *dst, const void *usrc, size_t size)
+{
+  if (!copy_from_user (dst, usrc, size))
+    thread_exit ();
+}
+
+/* Copies the null-terminated string at user address US into a
+   new page and returns it.  The caller must free the page with
+   palloc_free_page().  Terminates the process if the string
+   cannot be read, if it is longer than a page, or if no page
+   is available. */
+static char *
+copy_in_string (const char *us)
+{
+  char *ks = palloc_get_page (0);
+  if (ks == NULL)
+    thread_exit ();
+  if (strncpy_from_user (ks, us, PGSIZE) < 0)
+    {
+      palloc_free_page (ks);
+      thread_exit ();
+    }
+  return ks;
+}
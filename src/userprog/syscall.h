@@ -1,6 +1,23 @@
 #ifndef USERPROG_SYSCALL_H
 #define USERPROG_SYSCALL_H
 
+#include "threads/synch.h"
+
+struct intr_frame;
+
+/* Serializes file system operations, and use of a process's file
+   descriptor table, which its ring worker shares.
+
+   No thread touches user memory while holding it, so a page fault
+   may always acquire it to read a page from a file.  It comes
+   before the frame table's lock: a thread that holds frame_lock
+   never waits for fs_lock (see vm/frame.c). */
+extern struct lock fs_lock;
+
 void syscall_init (void);
+void syscall_handler (struct intr_frame *);
+
+/* SYSENTER entry point, in sysenter.S. */
+void sysenter_entry (void);
 
 #endif /* userprog/syscall.h */
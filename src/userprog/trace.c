@@ -0,0 +1,215 @@
+#include "userprog/trace.h"
+#include <debug.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "threads/cpu.h"
+#include "threads/malloc.h"
+#include "threads/thread.h"
+
+/* System call tracing.
+
+   A traced process records each of its system calls in a ring of
+   TRACE_RECORDS records: the call's number, arguments, and
+   return value, and the time-stamp counter at entry and exit.
+   Recording a call costs two RDTSCs and a few stores, where
+   printing it would cost a trip through the console lock and the
+   serial port, so tracing barely disturbs the timing it
+   measures.  Once the ring fills, each new record overwrites the
+   oldest, so the trace always ends with the process's last
+   TRACE_RECORDS calls.  Every call, recorded or not, also counts
+   toward per-call totals.
+
+   Tracing starts for every process with the kernel option
+   -strace, or for one process with trace(true), and is inherited
+   by the children it forks.
+
+   When the process exits or stops tracing, it prints the ring,
+   one line per call, and then the totals:
+
+     trace: NAME: begin RECORDS records, DROPPED dropped
+     trace: NAME: +DELTA NR(ARG,...) = RET CYCLES
+     ...
+     trace: NAME: end
+     trace: NAME: syscall NR: CALLS calls, AVG cycles avg, MAX max
+
+   DELTA is the time from the previous call's entry, or from the
+   start of the trace for the first, and CYCLES the time the call
+   took, both in cycles.  All the numbers in a record are in
+   hexadecimal, to keep the dump short.  A call that had not
+   returned when the trace was printed, such as exit() or the
+   trace() call that stopped tracing, has "?" for RET and
+   CYCLES.
+   utils/pintos-strace turns a dump into something more
+   readable. */
+
+/* Number of records in a trace. */
+#define TRACE_RECORDS 256
+
+/* Most arguments recorded per call. */
+#define TRACE_ARGS 4
+
+/* System call numbers with totals.  Larger numbers are recorded
+   but not totaled. */
+#define TRACE_SYSCALLS 64
+
+/* One system call. */
+struct trace_record
+  {
+    unsigned nr;                /* System call number. */
+    unsigned arg_cnt;           /* Number of arguments. */
+    int args[TRACE_ARGS];       /* Arguments. */
+    int retval;                 /* Return value. */
+    uint64_t start;             /* Time-stamp counter at entry. */
+    uint64_t end;               /* Time-stamp counter at exit, or 0. */
+  };
+
+/* Totals for one system call number. */
+struct trace_total
+  {
+    unsigned calls;             /* Number of completed calls. */
+    uint64_t cycles;            /* Total cycles in those calls. */
+    uint64_t max_cycles;        /* Longest call. */
+  };
+
+/* A process's trace. */
+struct trace
+  {
+    uint64_t start;             /* Time-stamp counter at start. */
+    unsigned seq;               /* Number of calls recorded. */
+    struct trace_record records[TRACE_RECORDS];
+    struct trace_total totals[TRACE_SYSCALLS];
+  };
+
+bool trace_all;
+
+static void dump (const struct trace *);
+
+/* Starts tracing the running process's system calls, if it is
+   not already.  Returns true if successful, false if memory
+   allocation fails. */
+bool
+trace_start (void)
+{
+  struct thread *t = thread_current ();
+
+  if (t->trace == NULL)
+    {
+      t->trace = calloc (1, sizeof *t->trace);
+      if (t->trace == NULL)
+        return false;
+      t->trace->start = rdtsc ();
+    }
+  return true;
+}
+
+/* Stops tracing the running process's system calls, if it is
+   tracing them, and prints its trace. */
+void
+trace_stop (void)
+{
+  struct thread *t = thread_current ();
+  struct trace *tr = t->trace;
+
+  if (tr != NULL)
+    {
+      t->trace = NULL;
+      dump (tr);
+      free (tr);
+    }
+}
+
+/* Records the start of system call NR, with the ARG_CNT
+   arguments in ARGS, for the running process, which must be
+   tracing.  Returns a sequence number to pass to trace_leave()
+   when the call returns. */
+unsigned
+trace_enter (unsigned nr, const int args[], size_t arg_cnt)
+{
+  struct trace *tr = thread_current ()->trace;
+  struct trace_record *r;
+  size_t i;
+
+  ASSERT (tr != NULL);
+  ASSERT (arg_cnt <= TRACE_ARGS);
+
+  r = &tr->records[tr->seq % TRACE_RECORDS];
+  r->nr = nr;
+  r->arg_cnt = arg_cnt;
+  for (i = 0; i < arg_cnt; i++)
+    r->args[i] = args[i];
+  r->end = 0;
+  r->start = rdtsc ();
+  return tr->seq++;
+}
+
+/* Records that the system call that trace_enter() gave sequence
+   number SEQ returned RETVAL.  Does nothing if the running
+   process stopped tracing in the meantime. */
+void
+trace_leave (unsigned seq, int retval)
+{
+  uint64_t end = rdtsc ();
+  struct trace *tr = thread_current ()->trace;
+  struct trace_record *r;
+  uint64_t cycles;
+
+  if (tr == NULL || tr->seq - seq > TRACE_RECORDS)
+    return;
+  r = &tr->records[seq % TRACE_RECORDS];
+  r->retval = retval;
+  r->end = end;
+
+  cycles = end - r->start;
+  if (r->nr < TRACE_SYSCALLS)
+    {
+      struct trace_total *total = &tr->totals[r->nr];
+      total->calls++;
+      total->cycles += cycles;
+      if (cycles > total->max_cycles)
+        total->max_cycles = cycles;
+    }
+}
+
+/* Prints trace TR for the running process, in the format
+   described at the top of this file. */
+static void
+dump (const struct trace *tr)
+{
+  const char *name = thread_current ()->name;
+  unsigned first = tr->seq > TRACE_RECORDS ? tr->seq - TRACE_RECORDS : 0;
+  uint64_t prev = tr->start;
+  unsigned seq;
+  unsigned nr;
+
+  printf ("trace: %s: begin %u records, %u dropped\n",
+          name, tr->seq - first, first);
+  for (seq = first; seq != tr->seq; seq++)
+    {
+      const struct trace_record *r = &tr->records[seq % TRACE_RECORDS];
+      char args[TRACE_ARGS * 9 + 1];
+      size_t i, ofs = 0;
+
+      for (i = 0; i < r->arg_cnt; i++)
+        ofs += snprintf (args + ofs, sizeof args - ofs, "%s%x",
+                         i > 0 ? "," : "", (unsigned) r->args[i]);
+      args[ofs] = '\0';
+      if (r->end != 0)
+        printf ("trace: %s: +%llx %x(%s) = %x %llx\n",
+                name, r->start - prev, r->nr, args, (unsigned) r->retval,
+                r->end - r->start);
+      else
+        printf ("trace: %s: +%llx %x(%s) = ? ?\n",
+                name, r->start - prev, r->nr, args);
+      prev = r->start;
+    }
+  printf ("trace: %s: end\n", name);
+
+  for (nr = 0; nr < TRACE_SYSCALLS; nr++)
+    {
+      const struct trace_total *total = &tr->totals[nr];
+      if (total->calls > 0)
+        printf ("trace: %s: syscall %u: %u calls, %llu cycles avg, "
+                "%llu max\n", name, nr, total->calls,
+                total->cycles / total->calls, total->max_cycles);
+    }
+}
@@ -0,0 +1,16 @@
+#ifndef USERPROG_TRACE_H
+#define USERPROG_TRACE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Trace every process's system calls?
+   Controlled by kernel command-line option "-strace". */
+extern bool trace_all;
+
+bool trace_start (void);
+void trace_stop (void);
+unsigned trace_enter (unsigned nr, const int args[], size_t arg_cnt);
+void trace_leave (unsigned seq, int retval);
+
+#endif /* userprog/trace.h */
@@ -2,6 +2,8 @@
 #include <debug.h>
 #include <stddef.h>
 #include "userprog/gdt.h"
+#include "userprog/syscall.h"
+#include "threads/cpu.h"
 #include "threads/thread.h"
 #include "threads/palloc.h"
 #include "threads/vaddr.h"
@@ -47,7 +49,15 @@
    See [IA32-v3a] 6.2.1 "Task-State Segment (TSS)" for a
    description of the TSS.  See [IA32-v3a] 5.12.1 "Exception- or
    Interrupt-Handler Procedures" for a description of when and
-   how stack switching occurs during an interrupt. */
+   how stack switching occurs during an interrupt.
+
+   SYSENTER, the fast system call instruction, does not consult
+   the TSS.  It loads the stack pointer from a model-specific
+   register instead, which would have to be rewritten on every
+   thread switch to track esp0.  We point that register, once, at
+   a small stack of its own whose top word holds the address of
+   the TSS's esp0 member, and the entry stub's first two
+   instructions load the real stack pointer from there. */
 struct tss
   {
     uint16_t back_link, :16;
@@ -75,6 +85,15 @@ struct tss
 /* Kernel TSS. */
 static struct tss *tss;
 
+/* Stack that SYSENTER switches to.  Its top word points to the
+   TSS's esp0 member.  The entry stub leaves this stack before it
+   pushes anything, so normally the rest goes unused.  But
+   SYSENTER does not clear the trap flag, so a process that sets
+   it takes a debug exception before the stub's first
+   instruction, and the CPU pushes that exception's frame here
+   (see debug() in exception.c). */
+static void *sysenter_stack[128];
+
 /* Initializes the kernel TSS. */
 void
 tss_init (void) 
@@ -86,6 +105,19 @@ tss_init (void)
   tss->ss0 = SEL_KDSEG;
   tss->bitmap = 0xdfff;
   tss_update ();
+
+  /* Enable SYSENTER, if the CPU supports it.  See [IA32-v3a]
+     5.8.7 "Performing Fast Calls to System Procedures with the
+     SYSENTER and SYSEXIT Instructions". */
+  if (cpu_has (CPUID_SEP))
+    {
+      void **top = &sysenter_stack[sizeof sysenter_stack
+                                   / sizeof *sysenter_stack - 1];
+      *top = &tss->esp0;
+      wrmsr (MSR_SYSENTER_CS, SEL_KCSEG);
+      wrmsr (MSR_SYSENTER_ESP, (uintptr_t) top);
+      wrmsr (MSR_SYSENTER_EIP, (uintptr_t) sysenter_entry);
+    }
 }
 
 /* Returns the kernel TSS. */
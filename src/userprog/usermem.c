@@ -0,0 +1,160 @@
+#include "userprog/usermem.h"
+#include <debug.h>
+#include "threads/vaddr.h"
+
+/* User memory access.
+
+   The kernel accesses user memory by dereferencing user
+   addresses directly, after checking only that they lie below
+   PHYS_BASE, instead of looking up each page in the page table
+   first.  Pages that are merely not resident are brought in by
+   page_fault() as usual.  An access that the process could not
+   make itself, to an unmapped page or a write to a read-only
+   one, faults, and page_fault() calls usermem_fixup().  That
+   looks up the faulting instruction in the exception table,
+   where each primitive below records every instruction that may
+   touch user memory, along with a "fixup" address just past it.
+   Execution resumes there, with EAX set to -1, and the
+   primitive reports failure.
+
+   Only the instructions in the exception table are recovered
+   this way.  A fault anywhere else in the kernel is still a
+   kernel bug. */
+
+/* Exception table entry. */
+struct ex_entry
+  {
+    uintptr_t insn;             /* Instruction that may fault. */
+    uintptr_t fixup;            /* Where to resume if it does. */
+  };
+
+/* Exception table, collected by the linker from the __ex_table
+   sections that EX_TABLE emits.  See kernel.lds.S. */
+extern const struct ex_entry _start_ex_table[], _end_ex_table[];
+
+/* Assembly that records an exception table entry for the
+   instruction at local label INSN, resuming at label FIXUP. */
+#define EX_TABLE(INSN, FIXUP)                   \
+        ".pushsection __ex_table, \"a\"\n"      \
+        ".long " #INSN ", " #FIXUP "\n"         \
+        ".popsection\n"
+
+/* Returns true if the SIZE bytes starting at UADDR all lie
+   below PHYS_BASE. */
+static bool
+is_user_range (const void *uaddr, size_t size)
+{
+  uintptr_t addr = (uintptr_t) uaddr;
+  return addr <= (uintptr_t) PHYS_BASE
+         && size <= (uintptr_t) PHYS_BASE - addr;
+}
+
+/* Reads a byte at user virtual address UADDR.  Returns the
+   byte value if successful, -1 if UADDR cannot be read. */
+int
+get_user (const uint8_t *uaddr)
+{
+  int result;
+
+  if (!is_user_vaddr (uaddr))
+    return -1;
+  asm volatile ("1: movzbl %1, %0\n"
+                "2:\n"
+                EX_TABLE (1b, 2b)
+                : "=a" (result) : "m" (*uaddr));
+  return result;
+}
+
+/* Writes BYTE to user address UDST.  Returns true if
+   successful, false if UDST cannot be written. */
+bool
+put_user (uint8_t *udst, uint8_t byte)
+{
+  int error = 0;
+
+  if (!is_user_vaddr (udst))
+    return false;
+  asm volatile ("1: movb %b2, %1\n"
+                "2:\n"
+                EX_TABLE (1b, 2b)
+                : "+a" (error), "=m" (*udst) : "q" (byte));
+  return error == 0;
+}
+
+/* Copies SIZE bytes from user address USRC to kernel address
+   DST.  Returns true if successful, false if any of the bytes
+   cannot be read, in which case some may have been copied. */
+bool
+copy_from_user (void *dst, const void *usrc, size_t size)
+{
+  if (!is_user_range (usrc, size))
+    return false;
+
+  /* A fault leaves the count of bytes not yet copied in ECX. */
+  asm volatile ("1: rep movsb\n"
+                "2:\n"
+                EX_TABLE (1b, 2b)
+                : "+c" (size), "+S" (usrc), "+D" (dst)
+                : : "eax", "memory");
+  return size == 0;
+}
+
+/* Copies SIZE bytes from kernel address SRC to user address
+   UDST.  Returns true if successful, false if any of the bytes
+   cannot be written, in which case some may have been
+   copied. */
+bool
+copy_to_user (void *udst, const void *src, size_t size)
+{
+  if (!is_user_range (udst, size))
+    return false;
+
+  asm volatile ("1: rep movsb\n"
+                "2:\n"
+                EX_TABLE (1b, 2b)
+                : "+c" (size), "+S" (src), "+D" (udst)
+                : : "eax", "memory");
+  return size == 0;
+}
+
+/* Copies the null-terminated string at user address USRC into
+   DST, a buffer of SIZE bytes.  Returns the length of the
+   string, not counting the null terminator, or -1 if it cannot
+   be read or does not fit in SIZE bytes with its null
+   terminator. */
+int
+strncpy_from_user (char *dst, const char *usrc, size_t size)
+{
+  size_t length;
+
+  for (length = 0; length < size; length++)
+    {
+      int c = get_user ((const uint8_t *) usrc + length);
+      if (c == -1)
+        return -1;
+      dst[length] = c;
+      if (c == '\0')
+        return length;
+    }
+  return -1;
+}
+
+/* Called by page_fault() for a fault in the kernel that it
+   could not resolve.  If the faulting instruction is one of the
+   user memory accesses above, arranges for F to resume at its
+   fixup address with EAX set to -1, and returns true.
+   Otherwise, returns false. */
+bool
+usermem_fixup (struct intr_frame *f)
+{
+  const struct ex_entry *e;
+
+  for (e = _start_ex_table; e < _end_ex_table; e++)
+    if (e->insn == (uintptr_t) f->eip)
+      {
+        f->eip = (void (*) (void)) e->fixup;
+        f->eax = -1;
+        return true;
+      }
+  return false;
+}
@@ -0,0 +1,1252 @@
+#include "vm/frame.h"
+#include <debug.h>
+#include <hash.h>
+#include <list.h>
+#include <stdio.h>
+#include <string.h>
+#include "vm/swap.h"
+#include "filesys/file.h"
+#include "userprog/pagedir.h"
+#include "userprog/syscall.h"
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/* Frame table.
+
+   Every frame from the user pool that holds a page of a user
+   process is described by a `struct frame', which records the
+   page directories and user virtual addresses that map it.
+   Usually there is just one mapping, but fork() shares all of a
+   process's frames with its child, copy-on-write: each frame
+   stays shared, read-only, until one of the processes writes to
+   it, at which point the writer gets a copy of its own, or, if
+   it is the last one left mapping the frame, simply gets write
+   access back.
+
+   When the user pool runs dry, a victim is chosen with the
+   "second chance" clock algorithm: all frames sit on a circular
+   list, and a clock hand sweeps across it.  A frame whose page
+   has been accessed since the hand last passed has its accessed
+   bit cleared and is skipped; the first frame whose page has not
+   is evicted to swap and reused.
+
+   Evicting a shared frame unmaps it from every process, each of
+   which then refers to the same swap slot.
+
+   Read-only pages of executables are shared, too, across all the
+   processes running the same executable: a frame that holds such
+   a page is entered in text_hash, keyed by the executable's inode
+   sector, the page's offset within it, and the number of bytes
+   read from it, and every process that faults on the same page
+   maps that frame.  The byte count matters because two segments
+   may share a page of the file, each reading a different part of
+   it and zeroing the rest.  Executables cannot be written while
+   they run, so these frames never go stale.  They are never
+   dirty, either, so evicting one only unmaps it, to be read from
+   the executable again on the next fault.
+
+   Pages of memory-mapped files are not swapped: evicting one
+   writes it back to its file, if it is dirty, and unmaps it.
+   They are not shared by fork().
+
+   Pages of zero-fill memory that have never been written all
+   map a single page of zeros, zero_page, read-only and
+   copy-on-write.  zero_page is not in the frame table, so it is
+   never evicted, and fork() does not share it: the child simply
+   faults the page in again.  The first write to such a page
+   gives the process a fresh zeroed frame instead.
+
+   A page that was read back from swap keeps its slot while it
+   stays resident, unless other processes still refer to the
+   slot.  If it is still clean when it is evicted again, its
+   contents need not be written back.
+
+   Evicting a page from inside a page fault puts the swap write
+   on the faulting process's critical path, so a "pageout" kernel
+   thread keeps some user frames free: whenever an allocation
+   leaves fewer than pageout_low frames free in the user pool, it
+   is woken to evict pages until pageout_high frames are free.
+   Faults then usually find a free frame right away, and only
+   reclaim "directly" when the daemon falls behind.  The daemon
+   then also writes a few dirty pages of process memory that the
+   clock hand is about to reach to swap, without evicting them,
+   so that evicting them later needs no write.
+
+   Processes often fill pages with identical contents, so an
+   optional "dedup" kernel thread periodically scans the frames
+   that hold ordinary process memory, hashing each one with
+   hash_bytes() into a content index built for the pass.  A frame
+   whose contents match one already indexed is merged into it:
+   all of its mappings are moved over, read-only and
+   copy-on-write, and it is freed.  A later write then separates
+   the pages again, as after fork().  The pass releases frame_lock
+   every DEDUP_BATCH frames, so that faults and eviction need not
+   wait for all of it.  Its place in frame_list is kept in a
+   second hand, which free_frame() moves along like the clock
+   hand, and the index refers to frames by kernel address, so
+   that a frame freed meanwhile is simply not found again.
+
+   frame_lock protects the frame table.  Eviction holds it
+   across the swap write, so that a process that faults on a
+   page in transit, which must allocate a frame before reading
+   the page back, waits for the write to complete.
+
+   Writing a page back to its memory-mapped file also requires
+   the file system lock, fs_lock, which is acquired before
+   frame_lock, never after: a thread holding fs_lock may allocate
+   frames, but a thread holding frame_lock never waits for
+   fs_lock.  Unmapping a page of a memory-mapped file other than
+   by eviction therefore requires the caller to hold fs_lock
+   already, and eviction passes over such a page while another
+   thread holds fs_lock. */
+
+/* A user frame. */
+struct frame
+  {
+    struct hash_elem hash_elem; /* Element in frame_hash. */
+    struct list_elem list_elem; /* Element in frame_list. */
+    void *kpage;                /* Kernel virtual address of frame. */
+    struct list mappings;       /* List of struct mapping. */
+    size_t swap_slot;           /* Slot holding a copy, or SWAP_ERROR. */
+    unsigned pin_cnt;           /* Exempt from eviction if nonzero. */
+
+    /* Pages of memory-mapped files only. */
+    struct file *file;          /* File to write back to, if dirty. */
+    off_t file_ofs;             /* Offset of page in FILE. */
+    size_t file_bytes;          /* Number of bytes to write back. */
+
+    /* Shared executable pages only. */
+    bool text;                  /* In text_hash? */
+    struct hash_elem text_elem; /* Element in text_hash. */
+    block_sector_t sector;      /* Executable's inode sector. */
+    off_t ofs;                  /* Offset of page in executable. */
+    size_t read_bytes;          /* Bytes read; the rest are zeros. */
+  };
+
+/* A mapping of a frame into a process's address space. */
+struct mapping
+  {
+    struct list_elem elem;      /* Element in frame's mappings. */
+    uint32_t *pagedir;          /* Page directory. */
+    void *upage;                /* User virtual address of page. */
+    struct thread *thread;      /* Process that owns PAGEDIR. */
+  };
+
+/* Frames indexed by kernel virtual address. */
+static struct hash frame_hash;
+
+/* Shared executable frames indexed by inode sector, offset, and
+   bytes read. */
+static struct hash text_hash;
+
+/* Frames in clock order, and the clock hand: the next frame to
+   examine, or list_end() to wrap around to the beginning.  The
+   dedup hand is the next frame for a deduplication pass to scan,
+   or null between passes. */
+static struct list frame_list;
+static struct list_elem *clock_hand;
+static struct list_elem *dedup_hand;
+
+/* Protects all of the above. */
+static struct lock frame_lock;
+
+/* Page of zeros shared by untouched zero-fill pages. */
+static void *zero_page;
+
+/* Page-out daemon watermarks, in free user frames, semaphore it
+   waits on, and whether it has been woken and not yet finished,
+   protected by frame_lock.  pageout_low is 0 if the daemon is not
+   running. */
+static size_t pageout_low, pageout_high;
+static struct semaphore pageout_sema;
+static bool pageout_awake;
+
+/* Number of frames ahead of the clock hand that the page-out
+   daemon examines for dirty pages to clean, and the most pages
+   it cleans each time it is woken. */
+#define PAGEOUT_CLEAN_SCAN 32
+#define PAGEOUT_CLEAN_MAX 8
+
+/* Statistics. */
+static long long direct_reclaim_cnt;     /* Evicted by frame_alloc(). */
+static long long background_reclaim_cnt; /* Evicted by page-out daemon. */
+static long long background_clean_cnt;   /* Cleaned by page-out daemon. */
+static long long pageout_wakeup_cnt;     /* Times daemon was woken. */
+
+/* Ticks between deduplication passes, or 0 if the dedup thread
+   is not running. */
+static int64_t dedup_interval;
+
+/* Number of frames that a deduplication pass scans between
+   releasing and reacquiring frame_lock. */
+#define DEDUP_BATCH 32
+
+/* An entry in a deduplication pass's content index. */
+struct dedup_entry
+  {
+    struct hash_elem elem;      /* Element in index. */
+    void *kpage;                /* Indexed frame's kernel address. */
+    unsigned hash;              /* Hash of frame's contents. */
+  };
+
+/* Deduplication statistics. */
+static long long dedup_pass_cnt;         /* Passes completed. */
+static long long dedup_merged_cnt;       /* Frames merged and freed. */
+static long long dedup_unmerged_cnt;     /* Frames scanned but kept. */
+
+static hash_hash_func frame_hash_func;
+static hash_less_func frame_less_func;
+static hash_hash_func text_hash_func;
+static hash_less_func text_less_func;
+static struct frame *alloc_frame (enum palloc_flags, void *upage);
+static struct frame *lookup_frame (void *kpage);
+static bool add_mapping (struct frame *, uint32_t *pd, void *upage);
+static void remove_mapping (struct frame *, struct mapping *);
+static void unmap_frame (struct frame *, struct mapping *);
+static void free_frame (struct frame *);
+static struct frame *evict_frame (void);
+static bool clean_frame_ahead (void);
+static size_t swap_hint (struct frame *);
+static thread_func pageout_daemon NO_RETURN;
+static thread_func dedup_daemon NO_RETURN;
+static void dedup_pass (void);
+static bool dedup_candidate (struct frame *);
+static bool merge_frames (struct frame *keep, struct frame *f);
+static hash_hash_func dedup_hash_func;
+static hash_less_func dedup_less_func;
+static hash_action_func dedup_destroy_func;
+
+/* Initializes the frame table. */
+void
+frame_init (void)
+{
+  if (!hash_init (&frame_hash, frame_hash_func, frame_less_func, NULL)
+      || !hash_init (&text_hash, text_hash_func, text_less_func, NULL))
+    PANIC ("frame table creation failed");
+  list_init (&frame_list);
+  clock_hand = list_end (&frame_list);
+  lock_init (&frame_lock);
+  zero_page = palloc_get_page (PAL_ASSERT | PAL_ZERO);
+}
+
+/* Starts the page-out daemon, which keeps between LOW and HIGH
+   user frames free.  HIGH defaults to twice LOW if it is less
+   than LOW.  HIGH is limited to half the free user pool, and LOW
+   to HIGH.  Does nothing if LOW is 0. */
+void
+frame_start_pageout (size_t low, size_t high)
+{
+  size_t max_high = palloc_free_cnt (PAL_USER) / 2;
+
+  if (high < low)
+    high = 2 * low;
+  if (high > max_high)
+    high = max_high;
+  if (low > high)
+    low = high;
+  if (low == 0)
+    return;
+
+  sema_init (&pageout_sema, 0);
+  pageout_high = high;
+  pageout_low = low;
+  thread_create ("pageout", PRI_DEFAULT, pageout_daemon, NULL);
+}
+
+/* Starts the dedup thread, which merges frames with identical
+   contents every INTERVAL timer ticks.  Does nothing if INTERVAL
+   is not positive. */
+void
+frame_start_dedup (int64_t interval)
+{
+  if (interval <= 0)
+    return;
+
+  dedup_interval = interval;
+  thread_create ("dedup", PRI_DEFAULT, dedup_daemon, NULL);
+}
+
+/* Prints frame reclaim statistics. */
+void
+frame_print_stats (void)
+{
+  printf ("Frames: %lld reclaimed directly, %lld in background, "
+          "%lld cleaned ahead, %lld page-out wakeups\n",
+          direct_reclaim_cnt, background_reclaim_cnt,
+          background_clean_cnt, pageout_wakeup_cnt);
+  if (dedup_interval > 0)
+    printf ("Dedup: %lld passes, %lld frames merged, %lld unmerged\n",
+            dedup_pass_cnt, dedup_merged_cnt, dedup_unmerged_cnt);
+}
+
+/* Obtains a frame from the user pool for user virtual page
+   UPAGE of the running process, evicting another page if
+   necessary, and returns its kernel virtual address.  The frame
+   is zeroed if PAL_ZERO is set in FLAGS.  Returns a null pointer
+   if no frame can be freed up.
+
+   The new frame is pinned.  Call frame_unpin() once UPAGE has
+   been mapped to it. */
+void *
+frame_alloc (enum palloc_flags flags, void *upage)
+{
+  struct frame *f = alloc_frame (flags, upage);
+  return f != NULL ? f->kpage : NULL;
+}
+
+/* Makes the frame at KPAGE eligible for eviction. */
+void
+frame_unpin (void *kpage)
+{
+  struct frame *f;
+
+  lock_acquire (&frame_lock);
+  f = lookup_frame (kpage);
+  ASSERT (f->pin_cnt > 0);
+  f->pin_cnt--;
+  lock_release (&frame_lock);
+}
+
+/* Frees the frame at KPAGE, which must not have been shared. */
+void
+frame_free (void *kpage)
+{
+  lock_acquire (&frame_lock);
+  free_frame (lookup_frame (kpage));
+  lock_release (&frame_lock);
+}
+
+/* Unmaps every frame mapped in page directory PD, freeing those
+   that no other page directory maps.  PD must not be active. */
+void
+frame_free_all (uint32_t *pd)
+{
+  struct list_elem *e;
+
+  lock_acquire (&frame_lock);
+  for (e = list_begin (&frame_list); e != list_end (&frame_list); )
+    {
+      struct frame *f = list_entry (e, struct frame, list_elem);
+      struct list_elem *m;
+
+      e = list_next (e);
+      for (m = list_begin (&f->mappings); m != list_end (&f->mappings); )
+        {
+          struct mapping *map = list_entry (m, struct mapping, elem);
+          m = list_next (m);
+          if (map->pagedir == pd)
+            unmap_frame (f, map);
+        }
+      if (list_empty (&f->mappings))
+        free_frame (f);
+    }
+  lock_release (&frame_lock);
+}
+
+/* Unmaps user virtual page UPAGE of the running process, if it
+   is resident, and frees its frame unless another process maps
+   it.  A dirty page of a memory-mapped file is written back.  If
+   the page is in swap instead, drops its reference to its swap
+   slot. */
+void
+frame_free_page (void *upage)
+{
+  uint32_t *pd = thread_current ()->pagedir;
+  void *kpage;
+  size_t slot;
+
+  lock_acquire (&frame_lock);
+  kpage = pagedir_get_page (pd, upage);
+  if (kpage != NULL && frame_is_zero (kpage))
+    pagedir_clear_page (pd, upage);
+  else if (kpage != NULL)
+    {
+      struct frame *f = lookup_frame (kpage);
+      struct list_elem *m;
+
+      for (m = list_begin (&f->mappings); m != list_end (&f->mappings);
+           m = list_next (m))
+        {
+          struct mapping *map = list_entry (m, struct mapping, elem);
+          if (map->pagedir == pd && map->upage == upage)
+            {
+              unmap_frame (f, map);
+              break;
+            }
+        }
+      if (list_empty (&f->mappings))
+        free_frame (f);
+    }
+  else if (pagedir_clear_swapped (pd, upage, &slot))
+    swap_free (slot);
+  lock_release (&frame_lock);
+}
+
+/* Shares every page of the parent process whose page directory
+   is PD with the running process, its child being created by
+   fork(), whose page directory must be new.  Resident pages are
+   mapped copy-on-write into both processes, and pages in swap
+   refer to the same slot.  The parent must not run meanwhile.
+   Returns true if successful, false if memory allocation
+   failed, in which case the child should exit. */
+bool
+frame_fork (uint32_t *pd)
+{
+  uint32_t *child_pd = thread_current ()->pagedir;
+  struct list_elem *e;
+  bool success;
+
+  /* Holding the lock keeps eviction from moving the parent's
+     pages between memory and swap while we copy. */
+  lock_acquire (&frame_lock);
+  success = pagedir_dup_swapped (child_pd, pd);
+  for (e = list_begin (&frame_list);
+       success && e != list_end (&frame_list); e = list_next (e))
+    {
+      struct frame *f = list_entry (e, struct frame, list_elem);
+      struct list_elem *m;
+
+      /* Memory-mapped files are not inherited. */
+      if (f->file != NULL)
+        continue;
+
+      /* Mappings added for the child go at the end of the list,
+         where the loop passes over them. */
+      for (m = list_begin (&f->mappings);
+           success && m != list_end (&f->mappings); m = list_next (m))
+        {
+          struct mapping *map = list_entry (m, struct mapping, elem);
+          if (map->pagedir == pd)
+            success = (add_mapping (f, child_pd, map->upage)
+                       && pagedir_share_page (child_pd, pd, map->upage));
+        }
+    }
+  lock_release (&frame_lock);
+
+  return success;
+}
+
+/* Handles a write by the running process to copy-on-write user
+   virtual page UPAGE.  If other processes still share the page's
+   frame, gives the running process a copy of its own; otherwise,
+   just makes the page writable again.  A page that maps the zero
+   page gets a fresh zeroed frame.  Returns true if successful,
+   false if UPAGE is not copy-on-write or no frame can be
+   obtained for the copy. */
+bool
+frame_copy_on_write (void *upage)
+{
+  uint32_t *pd = thread_current ()->pagedir;
+  struct frame *f, *copy;
+  struct list_elem *m;
+  void *kpage;
+  bool success = false;
+
+  lock_acquire (&frame_lock);
+  if (pd == NULL || !pagedir_is_cow (pd, upage))
+    goto done;
+
+  kpage = pagedir_get_page (pd, upage);
+  if (kpage == zero_page)
+    {
+      lock_release (&frame_lock);
+      copy = alloc_frame (PAL_ZERO, upage);
+      lock_acquire (&frame_lock);
+      if (copy == NULL)
+        goto done;
+      goto remap;
+    }
+
+  f = lookup_frame (kpage);
+  if (list_size (&f->mappings) == 1)
+    {
+      pagedir_clear_cow (pd, upage);
+      success = true;
+      goto done;
+    }
+
+  /* Keep the shared frame from being evicted while we copy it,
+     then move our mapping over to the copy.  Other processes
+     sharing the frame may be doing the same, each with a pin of
+     its own. */
+  f->pin_cnt++;
+  lock_release (&frame_lock);
+  copy = alloc_frame (0, upage);
+  lock_acquire (&frame_lock);
+  f->pin_cnt--;
+  if (copy == NULL)
+    goto done;
+
+  memcpy (copy->kpage, f->kpage, PGSIZE);
+  for (m = list_begin (&f->mappings); m != list_end (&f->mappings);
+       m = list_next (m))
+    {
+      struct mapping *map = list_entry (m, struct mapping, elem);
+      if (map->pagedir == pd && map->upage == upage)
+        {
+          remove_mapping (f, map);
+          break;
+        }
+    }
+
+  /* The other processes may have let go of the frame while we
+     were allocating. */
+  if (list_empty (&f->mappings))
+    free_frame (f);
+
+ remap:
+  pagedir_clear_page (pd, upage);
+  if (!pagedir_set_page (pd, upage, copy->kpage, true))
+    NOT_REACHED ();
+  copy->pin_cnt--;
+  success = true;
+
+ done:
+  lock_release (&frame_lock);
+  return success;
+}
+
+/* If user virtual page UPAGE of the running process was evicted
+   to swap, reads it back into a new frame, maps it, and returns
+   true.  Otherwise, or if no frame can be obtained, returns
+   false. */
+bool
+frame_swap_in (void *upage)
+{
+  uint32_t *pd = thread_current ()->pagedir;
+  struct frame *f;
+  size_t slot;
+  bool writable;
+
+  if (pd == NULL || !pagedir_get_swapped (pd, upage, &slot, &writable))
+    return false;
+
+  f = alloc_frame (0, upage);
+  if (f == NULL)
+    return false;
+  if (swap_read (slot, f->kpage))
+    thread_current ()->vm_usage.major_faults++;
+  thread_current ()->vm_usage.swap_ins++;
+  if (!pagedir_set_page (pd, upage, f->kpage, writable))
+    {
+      frame_free (f->kpage);
+      return false;
+    }
+
+  /* The slot still holds an identical copy of the page, which we
+     may keep unless other processes still need it. */
+  if (swap_claim (slot))
+    f->swap_slot = slot;
+  frame_unpin (f->kpage);
+  return true;
+}
+
+/* Maps user virtual page UPAGE of the running process to the
+   zero page: read-only if WRITABLE is false, otherwise
+   copy-on-write, so that the first write gives the process a
+   zeroed frame of its own.  Returns true if successful, false if
+   memory allocation fails. */
+bool
+frame_map_zero (void *upage, bool writable)
+{
+  uint32_t *pd = thread_current ()->pagedir;
+
+  if (writable)
+    return pagedir_set_page_cow (pd, upage, zero_page);
+  else
+    return pagedir_set_page (pd, upage, zero_page, false);
+}
+
+/* Returns true if KPAGE is the zero page, which page directories
+   may map but must never free. */
+bool
+frame_is_zero (const void *kpage)
+{
+  return kpage == zero_page;
+}
+
+/* If a frame holds the page at offset OFS in the executable whose
+   inode is in SECTOR, with READ_BYTES bytes read from it and the
+   rest zeroed, maps it read-only at user virtual page UPAGE of
+   the running process and returns true.  Otherwise, returns
+   false. */
+bool
+frame_map_text (block_sector_t sector, off_t ofs, size_t read_bytes,
+                void *upage)
+{
+  uint32_t *pd = thread_current ()->pagedir;
+  struct frame key, *f;
+  struct hash_elem *e;
+  bool success = false;
+
+  lock_acquire (&frame_lock);
+  key.sector = sector;
+  key.ofs = ofs;
+  key.read_bytes = read_bytes;
+  e = hash_find (&text_hash, &key.text_elem);
+  if (e != NULL)
+    {
+      f = hash_entry (e, struct frame, text_elem);
+      if (add_mapping (f, pd, upage))
+        {
+          if (pagedir_set_page (pd, upage, f->kpage, false))
+            success = true;
+          else
+            remove_mapping (f, list_entry (list_back (&f->mappings),
+                                           struct mapping, elem));
+        }
+    }
+  lock_release (&frame_lock);
+
+  return success;
+}
+
+/* Offers the frame at KPAGE, which holds the page at offset OFS
+   in the executable whose inode is in SECTOR, with READ_BYTES
+   bytes read from it and the rest zeroed, for sharing with other
+   processes that run the same executable.  The page must be
+   mapped read-only.  Does nothing if another frame already holds
+   the page. */
+void
+frame_share_text (void *kpage, block_sector_t sector, off_t ofs,
+                  size_t read_bytes)
+{
+  struct frame *f;
+
+  lock_acquire (&frame_lock);
+  f = lookup_frame (kpage);
+  ASSERT (!f->text);
+  f->sector = sector;
+  f->ofs = ofs;
+  f->read_bytes = read_bytes;
+  f->text = hash_insert (&text_hash, &f->text_elem) == NULL;
+  lock_release (&frame_lock);
+}
+
+/* Records that the frame at KPAGE holds the page at offset OFS in
+   memory-mapped FILE, of which BYTES bytes are to be written back
+   if the page is modified.  FILE must stay open until the page
+   is unmapped. */
+void
+frame_set_file (void *kpage, struct file *file, off_t ofs, size_t bytes)
+{
+  struct frame *f;
+
+  lock_acquire (&frame_lock);
+  f = lookup_frame (kpage);
+  f->file = file;
+  f->file_ofs = ofs;
+  f->file_bytes = bytes;
+  lock_release (&frame_lock);
+}
+
+/* Allocates a pinned frame for UPAGE of the running process, as
+   described for frame_alloc(), and returns it. */
+static struct frame *
+alloc_frame (enum palloc_flags flags, void *upage)
+{
+  struct frame *f = NULL;
+  void *kpage;
+
+  lock_acquire (&frame_lock);
+  kpage = palloc_get_page (PAL_USER | flags);
+  if (kpage != NULL)
+    {
+      f = malloc (sizeof *f);
+      if (f != NULL)
+        {
+          f->kpage = kpage;
+          list_init (&f->mappings);
+          hash_insert (&frame_hash, &f->hash_elem);
+
+          /* Insert just behind the clock hand, so that the hand
+             reaches the new frame last. */
+          list_insert (clock_hand, &f->list_elem);
+        }
+      else
+        palloc_free_page (kpage);
+    }
+  else
+    {
+      f = evict_frame ();
+      if (f != NULL)
+        {
+          direct_reclaim_cnt++;
+          if (flags & PAL_ZERO)
+            memset (f->kpage, 0, PGSIZE);
+        }
+    }
+
+  if (palloc_free_cnt (PAL_USER) < pageout_low && !pageout_awake)
+    {
+      pageout_awake = true;
+      sema_up (&pageout_sema);
+    }
+
+  if (f != NULL)
+    {
+      f->swap_slot = SWAP_ERROR;
+      f->pin_cnt = 1;
+      f->file = NULL;
+      f->text = false;
+      if (!add_mapping (f, thread_current ()->pagedir, upage))
+        {
+          free_frame (f);
+          f = NULL;
+        }
+    }
+  lock_release (&frame_lock);
+
+  return f;
+}
+
+/* Returns the frame whose kernel virtual address is KPAGE.
+   The frame must exist. */
+static struct frame *
+lookup_frame (void *kpage)
+{
+  struct frame key;
+  struct hash_elem *e;
+
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+
+  key.kpage = kpage;
+  e = hash_find (&frame_hash, &key.hash_elem);
+  ASSERT (e != NULL);
+  return hash_entry (e, struct frame, hash_elem);
+}
+
+/* Records that F is mapped at UPAGE in page directory PD, which
+   belongs to the running process, and counts the page as
+   resident.  Returns true if successful, false if memory
+   allocation failed. */
+static bool
+add_mapping (struct frame *f, uint32_t *pd, void *upage)
+{
+  struct mapping *map = malloc (sizeof *map);
+  struct vm_usage *usage;
+
+  if (map == NULL)
+    return false;
+  map->pagedir = pd;
+  map->upage = upage;
+  map->thread = thread_current ();
+  list_push_back (&f->mappings, &map->elem);
+
+  usage = &map->thread->vm_usage;
+  if (++usage->rss > usage->peak_rss)
+    usage->peak_rss = usage->rss;
+  return true;
+}
+
+/* Removes MAP from F's mappings and frees it.  Does not touch the
+   page table. */
+static void
+remove_mapping (struct frame *f UNUSED, struct mapping *map)
+{
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+
+  map->thread->vm_usage.rss--;
+  list_remove (&map->elem);
+  free (map);
+}
+
+/* Unmaps F from the page described by MAP and removes MAP.  If F
+   holds a page of a memory-mapped file and the page is dirty,
+   writes it back first, which requires the file system lock. */
+static void
+unmap_frame (struct frame *f, struct mapping *map)
+{
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+
+  if (pagedir_unmap_page (map->pagedir, map->upage) && f->file != NULL)
+    {
+      ASSERT (lock_held_by_current_thread (&fs_lock));
+      file_write_at (f->file, f->kpage, f->file_bytes, f->file_ofs);
+    }
+  remove_mapping (f, map);
+}
+
+/* Removes F from the frame table and frees it, along with its
+   remaining mappings and the swap slot holding a copy of its
+   page, if any.  Does not touch the page tables. */
+static void
+free_frame (struct frame *f)
+{
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+
+  while (!list_empty (&f->mappings))
+    remove_mapping (f, list_entry (list_front (&f->mappings),
+                                   struct mapping, elem));
+  hash_delete (&frame_hash, &f->hash_elem);
+  if (f->text)
+    hash_delete (&text_hash, &f->text_elem);
+  if (clock_hand == &f->list_elem)
+    clock_hand = list_next (&f->list_elem);
+  if (dedup_hand == &f->list_elem)
+    dedup_hand = list_next (&f->list_elem);
+  list_remove (&f->list_elem);
+  if (f->swap_slot != SWAP_ERROR)
+    swap_free (f->swap_slot);
+  palloc_free_page (f->kpage);
+  free (f);
+}
+
+/* Returns true if any mapping of F has been accessed since the
+   last call, and clears the accessed bits. */
+static bool
+test_and_clear_accessed (struct frame *f)
+{
+  struct list_elem *m;
+  bool accessed = false;
+
+  for (m = list_begin (&f->mappings); m != list_end (&f->mappings);
+       m = list_next (m))
+    {
+      struct mapping *map = list_entry (m, struct mapping, elem);
+      if (pagedir_is_accessed (map->pagedir, map->upage))
+        {
+          pagedir_set_accessed (map->pagedir, map->upage, false);
+          accessed = true;
+        }
+    }
+  return accessed;
+}
+
+/* Chooses a frame to evict with the clock algorithm, writes its
+   page to swap, and unmaps it from every process that maps it.
+   Returns the frame, now free for reuse but still in the frame
+   table, with no mappings, or a null pointer if every frame is
+   pinned or swap is full. */
+static struct frame *
+evict_frame (void)
+{
+  size_t sweep_cnt = 2 * hash_size (&frame_hash);
+  size_t i;
+
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+
+  /* Two full sweeps are always enough to come back around to a
+     frame whose accessed bit the first sweep cleared. */
+  for (i = 0; i < sweep_cnt; i++)
+    {
+      struct frame *f;
+      bool must_write;
+
+      if (clock_hand == list_end (&frame_list))
+        clock_hand = list_begin (&frame_list);
+      f = list_entry (clock_hand, struct frame, list_elem);
+      clock_hand = list_next (clock_hand);
+
+      if (f->pin_cnt > 0 || test_and_clear_accessed (f))
+        continue;
+
+      /* A page that can be read back from its file is written
+         back if dirty, and dropped.  A page of a memory-mapped
+         file waits for another pass if we would have to wait for
+         the file system lock. */
+      if (f->text || f->file != NULL)
+        {
+          bool locked = false;
+
+          if (f->file != NULL && !lock_held_by_current_thread (&fs_lock))
+            {
+              if (!lock_try_acquire (&fs_lock))
+                continue;
+              locked = true;
+            }
+          while (!list_empty (&f->mappings))
+            unmap_frame (f, list_entry (list_front (&f->mappings),
+                                        struct mapping, elem));
+          if (locked)
+            lock_release (&fs_lock);
+          if (f->text)
+            hash_delete (&text_hash, &f->text_elem);
+          f->text = false;
+          f->file = NULL;
+          return f;
+        }
+
+      /* Reuse the slot that already holds a copy of the page, if
+         any.  The copy is stale only if the page is dirty. */
+      must_write = f->swap_slot == SWAP_ERROR;
+      if (must_write)
+        {
+          f->swap_slot = swap_alloc (swap_hint (f));
+          if (f->swap_slot == SWAP_ERROR)
+            return NULL;
+        }
+
+      /* Point every mapping at the slot.  The slot already has a
+         reference for the first one. */
+      while (!list_empty (&f->mappings))
+        {
+          struct mapping *map = list_entry (list_front (&f->mappings),
+                                            struct mapping, elem);
+          if (pagedir_set_swapped (map->pagedir, map->upage, f->swap_slot))
+            must_write = true;
+          map->thread->vm_usage.swap_outs++;
+          remove_mapping (f, map);
+          if (!list_empty (&f->mappings))
+            swap_dup (f->swap_slot);
+        }
+      if (must_write)
+        swap_write (f->swap_slot, f->kpage);
+
+      /* The slot now belongs to the page table entries. */
+      f->swap_slot = SWAP_ERROR;
+      return f;
+    }
+  return NULL;
+}
+
+/* Looks at the PAGEOUT_CLEAN_SCAN frames that the clock hand
+   reaches next for a dirty page of ordinary process memory that
+   has not been accessed since the hand last passed it.  Writes
+   the first one found to swap, keeping it in memory, and returns
+   true.  Returns false if there is none, or if swap is full.
+
+   The frame keeps the slot as a clean copy of its page, as after
+   it is read back from swap.  The dirty bits are cleared before
+   the write, so a process that writes the page during or after
+   the write marks the copy stale again. */
+static bool
+clean_frame_ahead (void)
+{
+  struct list_elem *e = clock_hand;
+  size_t i;
+
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+
+  for (i = 0; i < PAGEOUT_CLEAN_SCAN && !list_empty (&frame_list); i++)
+    {
+      struct frame *f;
+      struct list_elem *m;
+      bool dirty = false;
+
+      if (e == list_end (&frame_list))
+        e = list_begin (&frame_list);
+      f = list_entry (e, struct frame, list_elem);
+      e = list_next (e);
+
+      if (f->pin_cnt > 0 || f->text || f->file != NULL)
+        continue;
+      for (m = list_begin (&f->mappings); m != list_end (&f->mappings);
+           m = list_next (m))
+        {
+          struct mapping *map = list_entry (m, struct mapping, elem);
+          if (pagedir_is_accessed (map->pagedir, map->upage))
+            break;
+          if (pagedir_is_dirty (map->pagedir, map->upage))
+            dirty = true;
+        }
+      if (m != list_end (&f->mappings) || !dirty)
+        continue;
+
+      if (f->swap_slot == SWAP_ERROR)
+        {
+          f->swap_slot = swap_alloc (swap_hint (f));
+          if (f->swap_slot == SWAP_ERROR)
+            return false;
+        }
+      for (m = list_begin (&f->mappings); m != list_end (&f->mappings);
+           m = list_next (m))
+        {
+          struct mapping *map = list_entry (m, struct mapping, elem);
+          pagedir_set_dirty (map->pagedir, map->upage, false);
+        }
+      swap_write (f->swap_slot, f->kpage);
+      return true;
+    }
+  return false;
+}
+
+/* Page-out daemon thread.  Each time it is woken, evicts pages
+   one at a time, so that faults need not wait long for
+   frame_lock, until at least pageout_high user frames are free
+   or nothing more can be evicted.  Then cleans up to
+   PAGEOUT_CLEAN_MAX dirty pages, also one at a time. */
+static void
+pageout_daemon (void *aux UNUSED)
+{
+  for (;;)
+    {
+      size_t i;
+      bool cleaned;
+
+      sema_down (&pageout_sema);
+      pageout_wakeup_cnt++;
+
+      while (palloc_free_cnt (PAL_USER) < pageout_high)
+        {
+          struct frame *f;
+
+          lock_acquire (&frame_lock);
+          f = evict_frame ();
+          if (f != NULL)
+            {
+              free_frame (f);
+              background_reclaim_cnt++;
+            }
+          lock_release (&frame_lock);
+
+          if (f == NULL)
+            break;
+        }
+
+      for (i = 0; i < PAGEOUT_CLEAN_MAX; i++)
+        {
+          lock_acquire (&frame_lock);
+          cleaned = clean_frame_ahead ();
+          if (cleaned)
+            background_clean_cnt++;
+          lock_release (&frame_lock);
+
+          if (!cleaned)
+            break;
+        }
+
+      lock_acquire (&frame_lock);
+      pageout_awake = false;
+      lock_release (&frame_lock);
+    }
+}
+
+/* Dedup thread.  Runs a deduplication pass every
+   dedup_interval ticks. */
+static void
+dedup_daemon (void *aux UNUSED)
+{
+  for (;;)
+    {
+      timer_sleep (dedup_interval);
+      dedup_pass ();
+    }
+}
+
+/* Scans every unpinned frame that holds ordinary process memory,
+   merging each into an earlier one with the same contents, if
+   any.  Holds frame_lock throughout, so that frames in the index
+   cannot be freed or change hands. */
+static void
+dedup_pass (void)
+{
+  struct hash index;
+  size_t merged = 0, unmerged = 0;
+  size_t scanned = 0;
+
+  if (!hash_init (&index, dedup_hash_func, dedup_less_func, NULL))
+    return;
+
+  lock_acquire (&frame_lock);
+  dedup_hand = list_begin (&frame_list);
+  while (dedup_hand != list_end (&frame_list))
+    {
+      struct frame *f = list_entry (dedup_hand, struct frame, list_elem);
+      struct dedup_entry *entry;
+      struct hash_elem *found;
+
+      /* Let other threads at the frame table now and then.  The
+         hand moves on if its frame is freed meanwhile. */
+      if (++scanned % DEDUP_BATCH == 0)
+        {
+          lock_release (&frame_lock);
+          lock_acquire (&frame_lock);
+          if (dedup_hand == list_end (&frame_list))
+            break;
+          f = list_entry (dedup_hand, struct frame, list_elem);
+        }
+
+      dedup_hand = list_next (dedup_hand);
+      if (!dedup_candidate (f))
+        continue;
+
+      entry = malloc (sizeof *entry);
+      if (entry == NULL)
+        break;
+      entry->kpage = f->kpage;
+      entry->hash = hash_bytes (f->kpage, PGSIZE);
+
+      /* The frame indexed under the same contents may have been
+         freed, or changed, since it was indexed.  If it is gone
+         or no longer a candidate, F takes its place in the index.
+         merge_frames() compares the contents again. */
+      found = hash_insert (&index, &entry->elem);
+      if (found != NULL)
+        {
+          struct dedup_entry *keep = hash_entry (found, struct dedup_entry,
+                                                 elem);
+          struct frame key, *k = NULL;
+          struct hash_elem *e;
+
+          free (entry);
+          key.kpage = keep->kpage;
+          e = hash_find (&frame_hash, &key.hash_elem);
+          if (e != NULL)
+            k = hash_entry (e, struct frame, hash_elem);
+          if (k != NULL && k != f && dedup_candidate (k)
+              && merge_frames (k, f))
+            {
+              merged++;
+              continue;
+            }
+          keep->kpage = f->kpage;
+        }
+      unmerged++;
+    }
+  dedup_hand = NULL;
+  lock_release (&frame_lock);
+  hash_destroy (&index, dedup_destroy_func);
+
+  dedup_pass_cnt++;
+  dedup_merged_cnt += merged;
+  dedup_unmerged_cnt += unmerged;
+  printf ("Dedup: pass %lld merged %zu frames, kept %zu\n",
+          dedup_pass_cnt, merged, unmerged);
+}
+
+/* Returns true if frame F holds ordinary process memory that a
+   deduplication pass may merge. */
+static bool
+dedup_candidate (struct frame *f)
+{
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+
+  return (f->pin_cnt == 0 && !f->text && f->file == NULL
+          && !list_empty (&f->mappings));
+}
+
+/* Moves all of F's mappings over to KEEP, making every mapping
+   of KEEP read-only and copy-on-write, and frees F, provided
+   their contents are still identical.  Returns true if
+   successful, false if the contents differ. */
+static bool
+merge_frames (struct frame *keep, struct frame *f)
+{
+  enum intr_level old_level;
+  struct list_elem *e;
+  bool merged = false;
+
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+
+  /* With interrupts off, no process can write either page
+     between the comparison and the switch to read-only
+     mappings. */
+  old_level = intr_disable ();
+  if (memcmp (keep->kpage, f->kpage, PGSIZE) == 0)
+    {
+      for (e = list_begin (&keep->mappings); e != list_end (&keep->mappings);
+           e = list_next (e))
+        {
+          struct mapping *map = list_entry (e, struct mapping, elem);
+          pagedir_merge_page (map->pagedir, map->upage, keep->kpage);
+        }
+      while (!list_empty (&f->mappings))
+        {
+          struct mapping *map = list_entry (list_pop_front (&f->mappings),
+                                            struct mapping, elem);
+          pagedir_merge_page (map->pagedir, map->upage, keep->kpage);
+          list_push_back (&keep->mappings, &map->elem);
+        }
+      merged = true;
+    }
+  intr_set_level (old_level);
+
+  if (merged)
+    free_frame (f);
+  return merged;
+}
+
+/* Returns the content hash of dedup_entry E. */
+static unsigned
+dedup_hash_func (const struct hash_elem *e, void *aux UNUSED)
+{
+  return hash_entry (e, struct dedup_entry, elem)->hash;
+}
+
+/* Returns true if the contents of dedup_entry A's frame precede
+   those of B's. */
+static bool
+dedup_less_func (const struct hash_elem *a_, const struct hash_elem *b_,
+                 void *aux UNUSED)
+{
+  const struct dedup_entry *a = hash_entry (a_, struct dedup_entry, elem);
+  const struct dedup_entry *b = hash_entry (b_, struct dedup_entry, elem);
+
+  if (a->hash != b->hash)
+    return a->hash < b->hash;
+  return memcmp (a->kpage, b->kpage, PGSIZE) < 0;
+}
+
+/* Frees dedup_entry E. */
+static void
+dedup_destroy_func (struct hash_elem *e, void *aux UNUSED)
+{
+  free (hash_entry (e, struct dedup_entry, elem));
+}
+
+/* Returns the swap slot right after the one holding the page
+   below F's first mapping in the same address space, if that
+   page is in swap, so that adjacent pages end up in adjacent
+   slots.  Otherwise, returns SWAP_ERROR. */
+static size_t
+swap_hint (struct frame *f)
+{
+  struct mapping *map;
+  size_t slot;
+  bool writable;
+
+  if (list_empty (&f->mappings))
+    return SWAP_ERROR;
+  map = list_entry (list_front (&f->mappings), struct mapping, elem);
+  if ((uint8_t *) map->upage < (uint8_t *) PGSIZE
+      || !pagedir_get_swapped (map->pagedir, (uint8_t *) map->upage - PGSIZE,
+                               &slot, &writable))
+    return SWAP_ERROR;
+  return slot + 1;
+}
+
+/* Returns a hash value for frame E. */
+static unsigned
+frame_hash_func (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct frame *f = hash_entry (e, struct frame, hash_elem);
+  return hash_bytes (&f->kpage, sizeof f->kpage);
+}
+
+/* Returns true if frame A precedes frame B. */
+static bool
+frame_less_func (const struct hash_elem *a_, const struct hash_elem *b_,
+                 void *aux UNUSED)
+{
+  const struct frame *a = hash_entry (a_, struct frame, hash_elem);
+  const struct frame *b = hash_entry (b_, struct frame, hash_elem);
+  return a->kpage < b->kpage;
+}
+
+/* Returns a hash value for shared executable frame E. */
+static unsigned
+text_hash_func (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct frame *f = hash_entry (e, struct frame, text_elem);
+  return (hash_int (f->sector) ^ hash_int (f->ofs)
+          ^ hash_int (f->read_bytes));
+}
+
+/* Returns true if shared executable frame A precedes frame B. */
+static bool
+text_less_func (const struct hash_elem *a_, const struct hash_elem *b_,
+                void *aux UNUSED)
+{
+  const struct frame *a = hash_entry (a_, struct frame, text_elem);
+  const struct frame *b = hash_entry (b_, struct frame, text_elem);
+  if (a->sector != b->sector)
+    return a->sector < b->sector;
+  if (a->ofs != b->ofs)
+    return a->ofs < b->ofs;
+  return a->read_bytes < b->read_bytes;
+}
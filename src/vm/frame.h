@@ -0,0 +1,33 @@
+#ifndef VM_FRAME_H
+#define VM_FRAME_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "devices/block.h"
+#include "filesys/off_t.h"
+#include "threads/palloc.h"
+
+struct file;
+
+void frame_init (void);
+void frame_start_pageout (size_t low, size_t high);
+void frame_start_dedup (int64_t interval);
+void frame_print_stats (void);
+void *frame_alloc (enum palloc_flags, void *upage);
+void frame_unpin (void *kpage);
+void frame_free (void *kpage);
+void frame_free_all (uint32_t *pd);
+void frame_free_page (void *upage);
+bool frame_swap_in (void *upage);
+bool frame_fork (uint32_t *child_pd);
+bool frame_copy_on_write (void *upage);
+bool frame_map_zero (void *upage, bool writable);
+bool frame_is_zero (const void *kpage);
+bool frame_map_text (block_sector_t sector, off_t ofs, size_t read_bytes,
+                     void *upage);
+void frame_share_text (void *kpage, block_sector_t sector, off_t ofs,
+                       size_t read_bytes);
+void frame_set_file (void *kpage, struct file *, off_t ofs, size_t bytes);
+
+#endif /* vm/frame.h */
@@ -0,0 +1,159 @@
+#include "vm/mmap.h"
+#include <debug.h>
+#include <list.h>
+#include <round.h>
+#include <stdint.h>
+#include "vm/page.h"
+#include "filesys/file.h"
+#include "threads/malloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/* Memory-mapped files.
+
+   mmap_map() maps a file, page by page, into consecutive pages
+   of the running process's address space.  Nothing is read up
+   front: each page is entered in the supplemental page table and
+   read straight from the file when the process first touches
+   it, with no intermediate copy.  A page goes back to the file
+   when it is evicted, when the mapping is removed, or when the
+   process exits, but only if the process wrote to it, as shown
+   by its dirty bit.
+
+   Mappings are not inherited by processes created with
+   fork(). */
+
+/* A memory-mapped file. */
+struct mmap
+  {
+    struct list_elem elem;      /* Element in thread's mmaps list. */
+    mapid_t id;                 /* Mapping identifier. */
+    struct file *file;          /* Mapped file, private to mapping. */
+    uint8_t *base;              /* First mapped page. */
+    size_t page_cnt;            /* Number of mapped pages. */
+  };
+
+static struct mmap *lookup_mmap (mapid_t);
+static void unmap (struct mmap *, size_t page_cnt);
+
+/* Maps FILE into the running process's address space, starting
+   at page-aligned user virtual address ADDR, and returns the new
+   mapping's identifier.  Returns MAPID_ERROR if FILE is empty,
+   if ADDR is null or not page-aligned, if any page of the range
+   is already in use, or if memory allocation fails.  The caller
+   must hold the file system lock. */
+mapid_t
+mmap_map (struct file *file, void *addr)
+{
+  struct thread *t = thread_current ();
+  struct mmap *m;
+  off_t length;
+  size_t i;
+
+  length = file_length (file);
+  if (length == 0 || addr == NULL || pg_ofs (addr) != 0)
+    return MAPID_ERROR;
+
+  m = malloc (sizeof *m);
+  if (m == NULL)
+    return MAPID_ERROR;
+  m->base = addr;
+  m->page_cnt = DIV_ROUND_UP (length, PGSIZE);
+
+  /* The range must lie in user space, clear of every page in
+     use. */
+  for (i = 0; i < m->page_cnt; i++)
+    {
+      uint8_t *upage = m->base + i * PGSIZE;
+      if (upage < m->base || !is_user_vaddr (upage) || page_in_use (upage))
+        {
+          free (m);
+          return MAPID_ERROR;
+        }
+    }
+
+  /* Use a file of our own, so that the mapping survives the
+     process closing FILE. */
+  m->file = file_reopen (file);
+  if (m->file == NULL)
+    {
+      free (m);
+      return MAPID_ERROR;
+    }
+
+  for (i = 0; i < m->page_cnt; i++)
+    {
+      off_t ofs = i * PGSIZE;
+      size_t read_bytes = length - ofs < PGSIZE ? length - ofs : PGSIZE;
+      if (!page_add_mapped (m->base + ofs, m->file, ofs, read_bytes))
+        {
+          unmap (m, i);
+          return MAPID_ERROR;
+        }
+    }
+
+  m->id = t->next_mapid++;
+  list_push_back (&t->mmaps, &m->elem);
+  return m->id;
+}
+
+/* Removes mapping ID of the running process, writing back the
+   pages it modified.  Does nothing if there is no such
+   mapping.  The caller must hold the file system lock. */
+void
+mmap_unmap (mapid_t id)
+{
+  struct mmap *m = lookup_mmap (id);
+  if (m != NULL)
+    {
+      list_remove (&m->elem);
+      unmap (m, m->page_cnt);
+    }
+}
+
+/* Removes all of the running process's mappings, writing back
+   the pages it modified.  The caller must hold the file system
+   lock. */
+void
+mmap_unmap_all (void)
+{
+  struct list *mmaps = &thread_current ()->mmaps;
+
+  while (!list_empty (mmaps))
+    {
+      struct mmap *m = list_entry (list_pop_front (mmaps),
+                                   struct mmap, elem);
+      unmap (m, m->page_cnt);
+    }
+}
+
+/* Returns the running process's mapping with identifier ID, or a
+   null pointer if there is none. */
+static struct mmap *
+lookup_mmap (mapid_t id)
+{
+  struct list *mmaps = &thread_current ()->mmaps;
+  struct list_elem *e;
+
+  for (e = list_begin (mmaps); e != list_end (mmaps); e = list_next (e))
+    {
+      struct mmap *m = list_entry (e, struct mmap, elem);
+      if (m->id == id)
+        return m;
+    }
+  return NULL;
+}
+
+/* Removes the first PAGE_CNT pages of M from the running
+   process's address space, then closes M's file and frees M.  M
+   must not be in the process's list of mappings. */
+static void
+unmap (struct mmap *m, size_t page_cnt)
+{
+  size_t i;
+
+  for (i = 0; i < page_cnt; i++)
+    page_remove (m->base + i * PGSIZE);
+  file_close (m->file);
+  free (m);
+}
@@ -0,0 +1,418 @@
+#include "vm/page.h"
+#include <debug.h>
+#include <hash.h>
+#include <stdio.h>
+#include <string.h>
+#include "vm/frame.h"
+#include "filesys/file.h"
+#include "filesys/inode.h"
+#include "userprog/pagedir.h"
+#include "userprog/syscall.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/* Supplemental page table.
+
+   Each process has a hash table, keyed by user virtual address,
+   that describes the pages of its address space that the page
+   table alone cannot: where their initial contents come from.
+   load() records every page of the executable's segments here
+   instead of reading them, and page_in() fills each one when
+   the process first touches it.
+
+   Read-only pages of the executable are shared with other
+   processes running the same executable, through the frame
+   table.
+
+   Pages of memory-mapped files are recorded here as well.  They
+   are written back to their file instead of going to swap.
+
+   Pages with nothing to read from their file start out mapped
+   to the frame table's shared zero page, so that zero-fill
+   memory the process never writes takes no frames.
+
+   A fault on a page backed by a file also brings in the other
+   pages of the same file in its aligned group of
+   page_fault_around pages ("fault-around"), since they will
+   probably be touched soon.  Pages found in memory are always
+   mapped, but a frame is only taken for one if plenty are free.
+
+   A page keeps its entry after it is loaded.  Once it has been
+   evicted, its page table entry refers to its swap slot, which
+   takes precedence over the entry. */
+
+/* A page whose contents come from a file. */
+struct page
+  {
+    struct hash_elem hash_elem; /* Element in thread's page table. */
+    void *upage;                /* User virtual address. */
+    struct file *file;          /* File to read from. */
+    off_t ofs;                  /* Offset in FILE. */
+    size_t read_bytes;          /* Bytes to read; the rest is zeroed. */
+    bool writable;              /* Writable by the user process? */
+    bool mapped;                /* Part of a memory-mapped file? */
+  };
+
+/* Statistics. */
+static long long page_load_cnt;     /* Pages read from files. */
+static long long page_zero_cnt;     /* Pages mapped to the zero page. */
+static long long page_share_cnt;    /* Executable pages found in memory. */
+long long page_mapped_ahead_cnt;    /* Pages mapped by fault-around,
+                                       whether used or not. */
+
+/* Number of pages in the aligned group that a page fault on a
+   file-backed page brings in together. */
+size_t page_fault_around = 8;
+
+static hash_hash_func page_hash_func;
+static hash_less_func page_less_func;
+static hash_action_func page_destroy_func;
+static struct page *page_lookup (void *upage);
+static bool load_page (struct page *, bool around);
+static void fault_around (struct page *);
+static bool add_page (void *upage, struct file *, off_t ofs,
+                      size_t read_bytes, bool writable, bool mapped);
+
+/* Creates and returns an empty supplemental page table, or
+   returns a null pointer if memory allocation fails. */
+struct hash *
+page_table_create (void)
+{
+  struct hash *pages = malloc (sizeof *pages);
+  if (pages != NULL
+      && !hash_init (pages, page_hash_func, page_less_func, NULL))
+    {
+      free (pages);
+      pages = NULL;
+    }
+  return pages;
+}
+
+/* Creates and returns a copy of supplemental page table PAGES,
+   for a child created by fork().  Pages to be read from the
+   parent's executable OLD_EXECUTABLE are read from EXECUTABLE,
+   the child's own handle for it, in the copy.  Pages of
+   memory-mapped files are not copied.  Returns a null pointer
+   if memory allocation fails. */
+struct hash *
+page_table_copy (struct hash *pages, struct file *old_executable,
+                 struct file *executable)
+{
+  struct hash *copy;
+  struct hash_iterator i;
+
+  copy = page_table_create ();
+  if (copy == NULL)
+    return NULL;
+
+  hash_first (&i, pages);
+  while (hash_next (&i))
+    {
+      struct page *p = hash_entry (hash_cur (&i), struct page, hash_elem);
+      struct page *q;
+
+      if (p->mapped)
+        continue;
+
+      q = malloc (sizeof *q);
+      if (q == NULL)
+        {
+          page_table_destroy (copy);
+          return NULL;
+        }
+      *q = *p;
+      if (q->file == old_executable)
+        q->file = executable;
+      hash_insert (copy, &q->hash_elem);
+    }
+  return copy;
+}
+
+/* Destroys supplemental page table PAGES, if it is nonnull. */
+void
+page_table_destroy (struct hash *pages)
+{
+  if (pages != NULL)
+    {
+      hash_destroy (pages, page_destroy_func);
+      free (pages);
+    }
+}
+
+/* Adds user virtual page UPAGE to the running process's address
+   space, to be filled on first access with READ_BYTES bytes
+   read from FILE starting at offset OFS, followed by zeros.
+   FILE must remain open as long as the process runs.  The page
+   is writable by the process if WRITABLE is true.  Returns true
+   if successful, false if UPAGE is already in the table or if
+   memory allocation fails. */
+bool
+page_add_file (void *upage, struct file *file, off_t ofs,
+               size_t read_bytes, bool writable)
+{
+  return add_page (upage, file, ofs, read_bytes, writable, false);
+}
+
+/* Adds user virtual page UPAGE to the running process's address
+   space as a writable mapping of the page at offset OFS in FILE,
+   which holds READ_BYTES bytes of the file.  The page is read on
+   first access, and written back to FILE whenever it leaves
+   memory dirty.  FILE must remain open until the page is removed
+   with page_remove().  Returns true if successful, false if
+   UPAGE is already in the table or if memory allocation
+   fails. */
+bool
+page_add_mapped (void *upage, struct file *file, off_t ofs,
+                 size_t read_bytes)
+{
+  return add_page (upage, file, ofs, read_bytes, true, true);
+}
+
+/* Adds user virtual page UPAGE to the running process's address
+   space as a writable page that reads as zeros until the process
+   writes it, as for the heap.  Returns true if successful, false
+   if UPAGE is already in the table or if memory allocation
+   fails. */
+bool
+page_add_zero (void *upage)
+{
+  return add_page (upage, NULL, 0, 0, true, false);
+}
+
+/* Removes user virtual page UPAGE, added with page_add_mapped()
+   or page_add_zero(), from the running process's address space.
+   A page of a memory-mapped file is written back to its file if
+   it is resident and dirty. */
+void
+page_remove (void *upage)
+{
+  struct page *p = page_lookup (upage);
+
+  ASSERT (p != NULL && (p->mapped || p->file == NULL));
+  frame_free_page (upage);
+  hash_delete (thread_current ()->pages, &p->hash_elem);
+  free (p);
+}
+
+/* Returns true if user virtual page UPAGE of the running process
+   is part of its address space, whether it is resident or
+   not. */
+bool
+page_in_use (void *upage)
+{
+  uint32_t *pd = thread_current ()->pagedir;
+  size_t slot;
+  bool writable;
+
+  return (page_lookup (upage) != NULL
+          || pagedir_get_page (pd, upage) != NULL
+          || pagedir_get_swapped (pd, upage, &slot, &writable));
+}
+
+/* Makes user virtual page UPAGE of the running process resident,
+   reading it back from swap or filling it from its supplemental
+   page table entry, and returns true.  Returns false if UPAGE is
+   not part of the process's address space or if it cannot be
+   brought in. */
+bool
+page_in (void *upage)
+{
+  uint32_t *pd = thread_current ()->pagedir;
+  struct page *p;
+  size_t slot;
+  bool writable;
+
+  if (pd == NULL)
+    return false;
+  if (pagedir_get_swapped (pd, upage, &slot, &writable))
+    return frame_swap_in (upage);
+
+  p = page_lookup (upage);
+  if (p == NULL || pagedir_get_page (pd, upage) != NULL
+      || !load_page (p, false))
+    return false;
+  if (p->read_bytes > 0)
+    fault_around (p);
+  return true;
+}
+
+/* Prints demand paging statistics. */
+void
+page_print_stats (void)
+{
+  printf ("Paging: %lld pages read on demand, %lld mapped to zero page, "
+          "%lld shared\n", page_load_cnt, page_zero_cnt, page_share_cnt);
+}
+
+/* Fills page P of the running process, which must not be
+   resident or in swap, and maps it.  If AROUND is true, P is
+   being mapped ahead of an access by fault_around(), which only
+   takes a frame for it if plenty are free.  Returns true if
+   successful, false on failure. */
+static bool
+load_page (struct page *p, bool around)
+{
+  uint32_t *pd = thread_current ()->pagedir;
+  void *upage = p->upage;
+  uint8_t *kpage;
+  block_sector_t sector = 0;
+  bool shared, read_ok;
+
+  /* Read-only pages of the executable may already be in memory
+     for another process running it. */
+  shared = (!p->writable && p->read_bytes > 0
+            && p->file == thread_current ()->executable);
+  if (shared)
+    {
+      sector = inode_get_inumber (file_get_inode (p->file));
+      if (frame_map_text (sector, p->ofs, p->read_bytes, upage))
+        {
+          page_share_cnt++;
+          return true;
+        }
+    }
+
+  if (p->read_bytes == 0 && !p->mapped)
+    {
+      if (!frame_map_zero (upage, p->writable))
+        return false;
+      page_zero_cnt++;
+      return true;
+    }
+
+  if (around && palloc_free_cnt (PAL_USER) <= page_fault_around)
+    return false;
+  kpage = frame_alloc (0, upage);
+  if (kpage == NULL)
+    return false;
+  lock_acquire (&fs_lock);
+  read_ok = (file_read_at (p->file, kpage, p->read_bytes, p->ofs)
+             == (off_t) p->read_bytes);
+  lock_release (&fs_lock);
+  if (!read_ok)
+    {
+      frame_free (kpage);
+      return false;
+    }
+  if (!around)
+    thread_current ()->vm_usage.major_faults++;
+  memset (kpage + p->read_bytes, 0, PGSIZE - p->read_bytes);
+  if (!pagedir_set_page (pd, upage, kpage, p->writable))
+    {
+      frame_free (kpage);
+      return false;
+    }
+  if (shared)
+    frame_share_text (kpage, sector, p->ofs, p->read_bytes);
+  else if (p->mapped)
+    frame_set_file (kpage, p->file, p->ofs, p->read_bytes);
+  frame_unpin (kpage);
+  page_load_cnt++;
+  return true;
+}
+
+/* Maps the pages of the running process that lie in the same
+   aligned group of page_fault_around pages as page P, which was
+   just loaded, that are backed by P's file and not yet in
+   memory.  Stops at the first page that cannot be loaded. */
+static void
+fault_around (struct page *p)
+{
+  uint32_t *pd = thread_current ()->pagedir;
+  uintptr_t first, upage;
+  size_t slot;
+  bool writable;
+
+  if (page_fault_around <= 1)
+    return;
+
+  first = pg_no (p->upage) / page_fault_around * page_fault_around;
+  for (upage = first << PGBITS;
+       upage < (first + page_fault_around) << PGBITS
+         && is_user_vaddr ((void *) upage);
+       upage += PGSIZE)
+    {
+      struct page *q = page_lookup ((void *) upage);
+
+      if (q == NULL || q == p || q->file != p->file
+          || q->mapped != p->mapped || q->read_bytes == 0
+          || pagedir_get_page (pd, q->upage) != NULL
+          || pagedir_get_swapped (pd, q->upage, &slot, &writable))
+        continue;
+      if (!load_page (q, true))
+        break;
+      page_mapped_ahead_cnt++;
+    }
+}
+
+/* Returns the running process's supplemental page table entry
+   for UPAGE, or a null pointer if there is none. */
+static struct page *
+page_lookup (void *upage)
+{
+  struct thread *t = thread_current ();
+  struct page key;
+  struct hash_elem *e;
+
+  if (t->pages == NULL)
+    return NULL;
+  key.upage = upage;
+  e = hash_find (t->pages, &key.hash_elem);
+  return e != NULL ? hash_entry (e, struct page, hash_elem) : NULL;
+}
+
+/* Adds a page to the running process's supplemental page table,
+   as described for page_add_file() and page_add_mapped(). */
+static bool
+add_page (void *upage, struct file *file, off_t ofs, size_t read_bytes,
+          bool writable, bool mapped)
+{
+  struct thread *t = thread_current ();
+  struct page *p;
+
+  ASSERT (pg_ofs (upage) == 0);
+  ASSERT (read_bytes <= PGSIZE);
+
+  p = malloc (sizeof *p);
+  if (p == NULL)
+    return false;
+  p->upage = upage;
+  p->file = file;
+  p->ofs = ofs;
+  p->read_bytes = read_bytes;
+  p->writable = writable;
+  p->mapped = mapped;
+  if (hash_insert (t->pages, &p->hash_elem) != NULL)
+    {
+      free (p);
+      return false;
+    }
+  return true;
+}
+
+/* Returns a hash value for page E. */
+static unsigned
+page_hash_func (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct page *p = hash_entry (e, struct page, hash_elem);
+  return hash_bytes (&p->upage, sizeof p->upage);
+}
+
+/* Returns true if page A precedes page B. */
+static bool
+page_less_func (const struct hash_elem *a_, const struct hash_elem *b_,
+                void *aux UNUSED)
+{
+  const struct page *a = hash_entry (a_, struct page, hash_elem);
+  const struct page *b = hash_entry (b_, struct page, hash_elem);
+  return a->upage < b->upage;
+}
+
+/* Frees page E. */
+static void
+page_destroy_func (struct hash_elem *e, void *aux UNUSED)
+{
+  free (hash_entry (e, struct page, hash_elem));
+}
@@ -0,0 +1,29 @@
+#ifndef VM_PAGE_H
+#define VM_PAGE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "filesys/off_t.h"
+
+struct file;
+struct hash;
+
+/* Fault-around group size, in pages, and pages it has mapped. */
+extern size_t page_fault_around;
+extern long long page_mapped_ahead_cnt;
+
+struct hash *page_table_create (void);
+struct hash *page_table_copy (struct hash *, struct file *old_executable,
+                              struct file *executable);
+void page_table_destroy (struct hash *);
+bool page_add_file (void *upage, struct file *, off_t ofs,
+                    size_t read_bytes, bool writable);
+bool page_add_mapped (void *upage, struct file *, off_t ofs,
+                      size_t read_bytes);
+bool page_add_zero (void *upage);
+void page_remove (void *upage);
+bool page_in_use (void *upage);
+bool page_in (void *upage);
+void page_print_stats (void);
+
+#endif /* vm/page.h */
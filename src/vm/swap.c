@@ -0,0 +1,532 @@
+#include "vm/swap.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <limits.h>
+#include <lz.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/block.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/* Swap space.
+
+   The swap device, the block device in the BLOCK_SWAP role, is
+   divided into page-size "slots" of SECTORS_PER_SLOT consecutive
+   sectors each.  A bitmap records which slots are in use.  If
+   there is no swap device, there are no slots, and every
+   swap_alloc() call fails.
+
+   A slot may be referenced by the page table entries of several
+   processes, when a process that had a page swapped out forks,
+   so each slot has a reference count.  It is freed when the last
+   reference is dropped.
+
+   Writing to the disk is slow, so pages written to swap first go
+   to the swap cache, where they are kept compressed in memory
+   obtained with malloc(), up to a limit set with the -swapcache
+   kernel option.  A page goes to its slot on disk only if it
+   does not compress well or if the cache is full.  A cached
+   copy stays in the cache until its slot is freed or written
+   again, so that a clean page read back from swap can still be
+   evicted again without any I/O.
+
+   Slots are allocated so that related pages end up next to each
+   other on disk: a page goes right after the slot of the page
+   below it in the same process's address space, if that slot is
+   free, and otherwise into the next free slot after the one
+   allocated last, so that pages evicted together are contiguous.
+   When a page has to be read from disk, the read-ahead thread
+   reads the other slots in its aligned cluster of SWAP_CLUSTER
+   slots, since they are likely to be needed soon.  It keeps them
+   uncompressed in a small read-ahead buffer of its own, whether
+   or not the swap cache is enabled, and the faulting thread does
+   not wait for it.  Slots being written and slots being read
+   ahead are flagged, so that read-ahead never keeps a stale copy
+   of a slot. */
+
+/* Number of sectors in a swap slot. */
+#define SECTORS_PER_SLOT (PGSIZE / BLOCK_SECTOR_SIZE)
+
+/* Number of slots in a read-ahead cluster. */
+#define SWAP_CLUSTER 8
+
+/* Swap device, or a null pointer if there is none. */
+static struct block *swap_device;
+
+/* Bitmap of used slots, reference count and flags of each slot,
+   next slot to consider for allocation, and lock that protects
+   them. */
+static struct bitmap *used_slots;
+static unsigned short *slot_refs;
+static uint8_t *slot_flags;
+static size_t next_slot;
+static struct lock swap_lock;
+
+/* Read-ahead buffer, also protected by swap_lock.  Page I of
+   READAHEAD holds a copy of slot READAHEAD_SLOT[I], or nothing if
+   that is SWAP_ERROR.  Pages are reused in round-robin order,
+   starting from READAHEAD_NEXT. */
+#define READAHEAD_PAGES SWAP_CLUSTER
+static uint8_t *readahead;
+static size_t readahead_slot[READAHEAD_PAGES];
+static size_t readahead_next;
+
+/* Cluster for the read-ahead thread to read next, or SWAP_ERROR,
+   also protected by swap_lock, and semaphore that wakes the
+   thread when it is set. */
+static size_t readahead_request = SWAP_ERROR;
+static struct semaphore readahead_sema;
+
+/* Slot flags. */
+#define SLOT_WRITING 0x1        /* Being written by swap_write(). */
+#define SLOT_READING 0x2        /* Being read ahead. */
+
+/* Statistics. */
+static long long swap_read_cnt;     /* Pages read from swap. */
+static long long swap_write_cnt;    /* Pages written to swap. */
+
+/* A compressed page in the swap cache. */
+struct cached_page
+  {
+    size_t size;                /* Size of DATA in bytes. */
+    uint8_t data[];             /* Compressed page. */
+  };
+
+/* Pages that compress to more than this are not cached. */
+#define CACHE_MAX_SIZE (PGSIZE / 4 * 3)
+
+/* Granularity of the compressed size histogram. */
+#define CACHE_HIST_STEP 512
+#define CACHE_HIST_CNT (CACHE_MAX_SIZE / CACHE_HIST_STEP)
+
+/* Swap cache, also protected by swap_lock.  CACHED is indexed by
+   slot number. */
+static struct cached_page **cached;
+static size_t cache_bytes;          /* Total size of cached pages. */
+static size_t cache_limit;          /* Maximum for cache_bytes. */
+static uint8_t cache_buffer[CACHE_MAX_SIZE];
+static struct lz_work cache_work;
+
+/* Swap cache statistics. */
+static long long cache_store_cnt;   /* Pages stored in cache. */
+static long long cache_store_bytes; /* Total compressed size. */
+static long long cache_reject_cnt;  /* Pages that did not compress. */
+static long long cache_spill_cnt;   /* Pages that found cache full. */
+static long long cache_hit_cnt;     /* Pages read from cache. */
+static long long cache_hist[CACHE_HIST_CNT]; /* Compressed sizes. */
+
+/* Read-ahead statistics. */
+static long long readahead_cnt;      /* Pages read ahead. */
+static long long readahead_hit_cnt;  /* Later read by swap_read(). */
+static long long readahead_miss_cnt; /* Dropped without being read. */
+
+static void read_slot (size_t slot, void *kpage);
+static thread_func readahead_daemon NO_RETURN;
+static void read_ahead (size_t slot);
+static bool readahead_load (size_t slot, void *kpage);
+static void readahead_drop (size_t slot);
+static bool cache_insert (size_t slot, const void *kpage);
+static bool cache_load (size_t slot, void *kpage);
+static void cache_drop (size_t slot);
+
+/* Initializes the swap space, with a swap cache of at most
+   CACHE_PAGES pages' worth of compressed data.  Must be called
+   after the block devices have been assigned their roles. */
+void
+swap_init (size_t cache_pages)
+{
+  size_t slot_cnt = 0;
+
+  swap_device = block_get_role (BLOCK_SWAP);
+  if (swap_device != NULL)
+    slot_cnt = block_size (swap_device) / SECTORS_PER_SLOT;
+
+  /* One extra reference count keeps calloc() from failing when
+     there are no slots. */
+  used_slots = bitmap_create (slot_cnt);
+  slot_refs = calloc (slot_cnt + 1, sizeof *slot_refs);
+  slot_flags = calloc (slot_cnt + 1, sizeof *slot_flags);
+  cached = calloc (slot_cnt + 1, sizeof *cached);
+  if (used_slots == NULL || slot_refs == NULL || slot_flags == NULL
+      || cached == NULL)
+    PANIC ("swap bitmap creation failed");
+  cache_limit = cache_pages * PGSIZE;
+  lock_init (&swap_lock);
+
+  /* Start the read-ahead thread, if there is anything to read. */
+  if (slot_cnt > 0)
+    {
+      size_t i;
+
+      readahead = palloc_get_multiple (0, READAHEAD_PAGES);
+      if (readahead == NULL)
+        return;
+      for (i = 0; i < READAHEAD_PAGES; i++)
+        readahead_slot[i] = SWAP_ERROR;
+      sema_init (&readahead_sema, 0);
+      thread_create ("readahead", PRI_DEFAULT, readahead_daemon, NULL);
+    }
+}
+
+/* Allocates a free swap slot, with one reference, and returns
+   its index, or SWAP_ERROR if swap is full.  If HINT is a free
+   slot, it is the one allocated. */
+size_t
+swap_alloc (size_t hint)
+{
+  size_t slot_cnt = bitmap_size (used_slots);
+  size_t slot;
+
+  lock_acquire (&swap_lock);
+  if (hint < slot_cnt && !bitmap_test (used_slots, hint))
+    {
+      bitmap_mark (used_slots, hint);
+      slot = hint;
+    }
+  else
+    {
+      slot = bitmap_scan_and_flip (used_slots, next_slot, 1, false);
+      if (slot == BITMAP_ERROR)
+        slot = bitmap_scan_and_flip (used_slots, 0, 1, false);
+    }
+  if (slot != BITMAP_ERROR)
+    {
+      slot_refs[slot] = 1;
+      next_slot = slot + 1 < slot_cnt ? slot + 1 : 0;
+    }
+  lock_release (&swap_lock);
+
+  return slot;
+}
+
+/* Adds a reference to SLOT, which must be in use. */
+void
+swap_dup (size_t slot)
+{
+  lock_acquire (&swap_lock);
+  ASSERT (bitmap_test (used_slots, slot));
+  ASSERT (slot_refs[slot] < USHRT_MAX);
+  slot_refs[slot]++;
+  lock_release (&swap_lock);
+}
+
+/* Drops a reference to SLOT, releasing it for reuse if it was
+   the last one. */
+void
+swap_free (size_t slot)
+{
+  lock_acquire (&swap_lock);
+  ASSERT (bitmap_test (used_slots, slot));
+  if (--slot_refs[slot] == 0)
+    {
+      cache_drop (slot);
+      readahead_drop (slot);
+      slot_flags[slot] = 0;
+      bitmap_reset (used_slots, slot);
+    }
+  lock_release (&swap_lock);
+}
+
+/* Called with a reference to SLOT whose contents have just been
+   read into memory.  If that is the only reference to SLOT,
+   returns true, and the caller may keep the slot as a copy of
+   the page that can be overwritten.  Otherwise, drops the
+   reference and returns false. */
+bool
+swap_claim (size_t slot)
+{
+  bool claimed;
+
+  lock_acquire (&swap_lock);
+  ASSERT (bitmap_test (used_slots, slot));
+  claimed = slot_refs[slot] == 1;
+  if (!claimed)
+    slot_refs[slot]--;
+  lock_release (&swap_lock);
+
+  return claimed;
+}
+
+/* Reads the page stored in SLOT into KPAGE.  Returns true if
+   the page had to be read from disk, false if it was found in
+   the swap cache or had already been read ahead.  After reading
+   from disk, wakes the read-ahead thread to read the rest of
+   SLOT's cluster. */
+bool
+swap_read (size_t slot, void *kpage)
+{
+  ASSERT (bitmap_test (used_slots, slot));
+  swap_read_cnt++;
+  if (cache_load (slot, kpage) || readahead_load (slot, kpage))
+    return false;
+  read_slot (slot, kpage);
+
+  if (readahead != NULL)
+    {
+      lock_acquire (&swap_lock);
+      readahead_request = slot;
+      lock_release (&swap_lock);
+      sema_up (&readahead_sema);
+    }
+  return true;
+}
+
+/* Writes the page at KPAGE into SLOT.  The page is stored in the
+   swap cache if it compresses well and fits, and otherwise
+   written to disk. */
+void
+swap_write (size_t slot, const void *kpage)
+{
+  const uint8_t *buffer = kpage;
+  bool cached;
+  size_t i;
+
+  ASSERT (bitmap_test (used_slots, slot));
+  swap_write_cnt++;
+
+  /* Setting the flags also cancels any read-ahead of the slot's
+     old contents. */
+  lock_acquire (&swap_lock);
+  cache_drop (slot);
+  readahead_drop (slot);
+  cached = cache_insert (slot, kpage);
+  slot_flags[slot] = cached ? 0 : SLOT_WRITING;
+  lock_release (&swap_lock);
+  if (cached)
+    return;
+
+  for (i = 0; i < SECTORS_PER_SLOT; i++)
+    block_write (swap_device, slot * SECTORS_PER_SLOT + i,
+                 buffer + i * BLOCK_SECTOR_SIZE);
+
+  lock_acquire (&swap_lock);
+  slot_flags[slot] &= ~SLOT_WRITING;
+  lock_release (&swap_lock);
+}
+
+/* Prints swap statistics. */
+void
+swap_print_stats (void)
+{
+  int i;
+
+  printf ("Swap: %lld pages read, %lld pages written\n",
+          swap_read_cnt, swap_write_cnt);
+  printf ("Swap cache: %lld pages stored at %lld%% of their size, "
+          "%lld incompressible, %lld spilled, %lld hits\n",
+          cache_store_cnt,
+          (cache_store_cnt
+           ? cache_store_bytes * 100 / (cache_store_cnt * PGSIZE) : 0),
+          cache_reject_cnt, cache_spill_cnt, cache_hit_cnt);
+  printf ("Swap cache: compressed sizes in %d-byte steps:",
+          CACHE_HIST_STEP);
+  for (i = 0; i < CACHE_HIST_CNT; i++)
+    printf (" %lld", cache_hist[i]);
+  printf ("\n");
+  printf ("Swap read-ahead: %lld pages read, %lld used, %lld unused\n",
+          readahead_cnt, readahead_hit_cnt, readahead_miss_cnt);
+}
+
+/* Reads SLOT from the swap device into KPAGE. */
+static void
+read_slot (size_t slot, void *kpage)
+{
+  uint8_t *buffer = kpage;
+  size_t i;
+
+  for (i = 0; i < SECTORS_PER_SLOT; i++)
+    block_read (swap_device, slot * SECTORS_PER_SLOT + i,
+                buffer + i * BLOCK_SECTOR_SIZE);
+}
+
+/* Read-ahead thread.  Each time it is woken, reads the cluster
+   of the slot that swap_read() last had to read from disk. */
+static void
+readahead_daemon (void *aux UNUSED)
+{
+  for (;;)
+    {
+      size_t slot;
+
+      sema_down (&readahead_sema);
+      lock_acquire (&swap_lock);
+      slot = readahead_request;
+      readahead_request = SWAP_ERROR;
+      lock_release (&swap_lock);
+
+      if (slot != SWAP_ERROR)
+        read_ahead (slot);
+    }
+}
+
+/* Reads the slots in the same cluster as SLOT that are in use,
+   but neither cached nor read ahead already, into the read-ahead
+   buffer. */
+static void
+read_ahead (size_t slot)
+{
+  size_t first = slot / SWAP_CLUSTER * SWAP_CLUSTER;
+  size_t last = first + SWAP_CLUSTER;
+  size_t s;
+
+  if (last > bitmap_size (used_slots))
+    last = bitmap_size (used_slots);
+
+  for (s = first; s < last; s++)
+    {
+      size_t i;
+      bool wanted;
+
+      lock_acquire (&swap_lock);
+      wanted = (s != slot
+                && bitmap_test (used_slots, s)
+                && cached[s] == NULL
+                && slot_flags[s] == 0);
+      for (i = 0; wanted && i < READAHEAD_PAGES; i++)
+        if (readahead_slot[i] == s)
+          wanted = false;
+      if (wanted)
+        {
+          /* Take the next page of the buffer, dropping what it
+             holds. */
+          i = readahead_next;
+          readahead_next = (i + 1) % READAHEAD_PAGES;
+          if (readahead_slot[i] != SWAP_ERROR)
+            readahead_miss_cnt++;
+          readahead_slot[i] = SWAP_ERROR;
+          slot_flags[s] = SLOT_READING;
+        }
+      lock_release (&swap_lock);
+      if (!wanted)
+        continue;
+
+      read_slot (s, readahead + i * PGSIZE);
+
+      /* The flag is gone if the slot was written or freed while we
+         were reading it. */
+      lock_acquire (&swap_lock);
+      if (slot_flags[s] & SLOT_READING)
+        {
+          slot_flags[s] = 0;
+          readahead_slot[i] = s;
+          readahead_cnt++;
+        }
+      lock_release (&swap_lock);
+    }
+}
+
+/* If SLOT has been read ahead, copies it into KPAGE, drops it
+   from the read-ahead buffer, and returns true.  Otherwise,
+   returns false. */
+static bool
+readahead_load (size_t slot, void *kpage)
+{
+  bool found = false;
+  size_t i;
+
+  if (readahead == NULL)
+    return false;
+
+  lock_acquire (&swap_lock);
+  for (i = 0; i < READAHEAD_PAGES; i++)
+    if (readahead_slot[i] == slot)
+      {
+        memcpy (kpage, readahead + i * PGSIZE, PGSIZE);
+        readahead_slot[i] = SWAP_ERROR;
+        readahead_hit_cnt++;
+        found = true;
+        break;
+      }
+  lock_release (&swap_lock);
+
+  return found;
+}
+
+/* Drops SLOT from the read-ahead buffer, if present. */
+static void
+readahead_drop (size_t slot)
+{
+  size_t i;
+
+  ASSERT (lock_held_by_current_thread (&swap_lock));
+  for (i = 0; i < READAHEAD_PAGES; i++)
+    if (readahead_slot[i] == slot)
+      {
+        readahead_slot[i] = SWAP_ERROR;
+        readahead_miss_cnt++;
+      }
+}
+
+/* Tries to store the page at KPAGE in the swap cache, compressed,
+   as the contents of SLOT, which must not be cached already.
+   Returns true if successful, false if the page does not
+   compress well or does not fit. */
+static bool
+cache_insert (size_t slot, const void *kpage)
+{
+  struct cached_page *page = NULL;
+  size_t size;
+
+  ASSERT (lock_held_by_current_thread (&swap_lock));
+  ASSERT (cached[slot] == NULL);
+  if (cache_limit == 0)
+    return false;
+
+  size = lz_compress (kpage, PGSIZE, cache_buffer, sizeof cache_buffer,
+                      &cache_work);
+  if (size == 0)
+    cache_reject_cnt++;
+  else if (cache_bytes + size > cache_limit
+           || (page = malloc (sizeof *page + size)) == NULL)
+    cache_spill_cnt++;
+  else
+    {
+      page->size = size;
+      memcpy (page->data, cache_buffer, size);
+      cached[slot] = page;
+      cache_bytes += size;
+      cache_store_cnt++;
+      cache_store_bytes += size;
+      cache_hist[(size - 1) / CACHE_HIST_STEP]++;
+    }
+  return page != NULL;
+}
+
+/* If SLOT's contents are in the swap cache, decompresses them
+   into KPAGE and returns true.  Otherwise, returns false. */
+static bool
+cache_load (size_t slot, void *kpage)
+{
+  struct cached_page *page;
+
+  lock_acquire (&swap_lock);
+  page = cached[slot];
+  if (page != NULL)
+    {
+      size_t size = lz_decompress (page->data, page->size, kpage, PGSIZE);
+      ASSERT (size == PGSIZE);
+      cache_hit_cnt++;
+    }
+  lock_release (&swap_lock);
+
+  return page != NULL;
+}
+
+/* Removes SLOT's contents from the swap cache, if present. */
+static void
+cache_drop (size_t slot)
+{
+  struct cached_page *page = cached[slot];
+
+  ASSERT (lock_held_by_current_thread (&swap_lock));
+  if (page != NULL)
+    {
+      cache_bytes -= page->size;
+      free (page);
+      cached[slot] = NULL;
+    }
+}
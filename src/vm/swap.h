@@ -0,0 +1,20 @@
+#ifndef VM_SWAP_H
+#define VM_SWAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Returned by swap_alloc() when no slot is free. */
+#define SWAP_ERROR SIZE_MAX
+
+void swap_init (size_t cache_pages);
+size_t swap_alloc (size_t hint);
+void swap_dup (size_t slot);
+void swap_free (size_t slot);
+bool swap_claim (size_t slot);
+bool swap_read (size_t slot, void *kpage);
+void swap_write (size_t slot, const void *kpage);
+void swap_print_stats (void);
+
+#endif /* vm/swap.h */